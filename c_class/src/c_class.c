@@ -0,0 +1,5701 @@
+#define C_CLASS_BUILD
+#include "c_class.h"
+#include "signal.h"
+
+// the out of line form of DEBUG_BREAK, a debugger stops here and can continue
+void class_debug_break(void)
+{
+#if defined(_MSC_VER)
+	__debugbreak();
+#elif defined(SIGTRAP)
+	raise(SIGTRAP);
+#else
+	abort();
+#endif
+}
+
+const char* member_type_to_string(MemberType type)
+{
+	switch (type) {
+		case MEMBER_TYPE_F32: return "f32";
+		case MEMBER_TYPE_F64: return "f64";
+		case MEMBER_TYPE_I32: return "i32";
+		case MEMBER_TYPE_U32: return "u32";
+		case MEMBER_TYPE_F32X2: return "f32x2";
+		case MEMBER_TYPE_F32X4: return "f32x4";
+		case MEMBER_TYPE_F32X8: return "f32x8";
+		case MEMBER_TYPE_F32_ARRAY: return "f32[]";
+	}
+
+	DEBUG_BREAK("unknown member type!");
+	return "";
+}
+
+// native width of a member value, arrays report the width of one element
+size_t member_type_get_size(MemberType type)
+{
+	switch (type) {
+		case MEMBER_TYPE_F32: return sizeof(float);
+		case MEMBER_TYPE_F64: return sizeof(double);
+		case MEMBER_TYPE_I32: return sizeof(int32_t);
+		case MEMBER_TYPE_U32: return sizeof(uint32_t);
+		case MEMBER_TYPE_F32X2: return sizeof(float) * 2;
+		case MEMBER_TYPE_F32X4: return sizeof(float) * 4;
+		case MEMBER_TYPE_F32X8: return sizeof(float) * 8;
+		case MEMBER_TYPE_F32_ARRAY: return sizeof(float);
+	}
+
+	DEBUG_BREAK("unknown member type!");
+	return 0;
+}
+
+// vectors are aligned to their full width so a kernel can load one with a single aligned load
+size_t member_type_get_alignment(MemberType type)
+{
+	if (type == MEMBER_TYPE_F32_ARRAY) {
+		return 16;
+	}
+
+	return member_type_get_size(type);
+}
+
+// the scalar type of one lane, vectors and arrays are made of f32 lanes
+MemberType member_type_get_lane_type(MemberType type)
+{
+	switch (type) {
+		case MEMBER_TYPE_F32:
+		case MEMBER_TYPE_F32X2:
+		case MEMBER_TYPE_F32X4:
+		case MEMBER_TYPE_F32X8:
+		case MEMBER_TYPE_F32_ARRAY:
+			return MEMBER_TYPE_F32;
+		case MEMBER_TYPE_F64: return MEMBER_TYPE_F64;
+		case MEMBER_TYPE_I32: return MEMBER_TYPE_I32;
+		case MEMBER_TYPE_U32: return MEMBER_TYPE_U32;
+	}
+
+	DEBUG_BREAK("unknown member type!");
+	return MEMBER_TYPE_F32;
+}
+
+// only values up to f32x2 fit in MemberData, wider members are accessed through their address
+static int member_type_fits_data(MemberType type)
+{
+	return type != MEMBER_TYPE_F32_ARRAY && member_type_get_size(type) <= sizeof(MemberData);
+}
+
+// reads a native-width value, source does not need to be aligned
+MemberData member_data_load(MemberType type, const void* source)
+{
+	MemberData data = { 0 };
+	CLASS_CHECK(member_type_fits_data(type) == 1, "member does not fit in member data!", data);
+	memcpy(&data, source, member_type_get_size(type));
+	return data;
+}
+
+void member_data_store(MemberType type, void* destination, MemberData data)
+{
+	CLASS_CHECK(member_type_fits_data(type) == 1, "member does not fit in member data!", );
+	memcpy(destination, &data, member_type_get_size(type));
+}
+
+const char* member_get_name(const Member* member)
+{
+	CLASS_CHECK_NULL(member, NULL);
+	return member->name;
+}
+
+NameAtom member_get_atom(const Member* member)
+{
+	CLASS_CHECK_NULL(member, NAME_ATOM_NONE);
+	return member->atom;
+}
+
+MemberType member_get_type(const Member* member)
+{
+	CLASS_CHECK_NULL(member, MEMBER_TYPE_I32);
+	return member->type;
+}
+
+MemberData member_get_data(const Member* member)
+{
+	CLASS_CHECK(member != NULL, "member was null!", (MemberData){ 0 });
+	return member->data;
+}
+
+size_t member_get_size(const Member* member)
+{
+	CLASS_CHECK_NULL(member, 0);
+
+	if (member->type == MEMBER_TYPE_F32_ARRAY) {
+		return member_type_get_size(member->type) * member->count;
+	}
+
+	return member_type_get_size(member->type);
+}
+
+// arrays of eight or more floats get the f32x8 alignment
+size_t member_get_alignment(const Member* member)
+{
+	CLASS_CHECK_NULL(member, 1);
+
+	if (member->type == MEMBER_TYPE_F32_ARRAY && member->count >= 8) {
+		return member_type_get_alignment(MEMBER_TYPE_F32X8);
+	}
+
+	return member_type_get_alignment(member->type);
+}
+
+const char* function_get_name(const Function* function)
+{
+	CLASS_CHECK_NULL(function, NULL);
+	return function->name;
+}
+
+NameAtom function_get_atom(const Function* function)
+{
+	CLASS_CHECK_NULL(function, NAME_ATOM_NONE);
+	return function->atom;
+}
+
+FunctionType function_get_type(const Function* function)
+{
+	CLASS_CHECK_NULL(function, FUNCTION_TYPE_MEMBER_FUNCTION);
+	return function->type;
+}
+
+// the hooks cost one relaxed load and a branch that is never taken while tracing is off
+static atomic_int s_trace_enabled = 0;
+
+#if CLASS_ENABLE_TRACING
+#define CLASS_TRACING() (atomic_load_explicit(&s_trace_enabled, memory_order_relaxed) != 0)
+#else
+#define CLASS_TRACING() 0
+#endif
+
+typedef enum ClassTraceKind {
+	CLASS_TRACE_CONSTRUCTOR,
+	CLASS_TRACE_DESTRUCTOR,
+	CLASS_TRACE_MEMBER_FUNCTION,
+	CLASS_TRACE_BATCH,
+} ClassTraceKind;
+
+static void class_trace_record(ClassTraceKind kind, NameAtom type, NameAtom function, uint64_t begin);
+
+static ClassTraceKind class_trace_get_kind(FunctionType type)
+{
+	switch (type) {
+		case FUNCTION_TYPE_CONSTRUCTOR: return CLASS_TRACE_CONSTRUCTOR;
+		case FUNCTION_TYPE_DESTRUCTOR: return CLASS_TRACE_DESTRUCTOR;
+		case FUNCTION_TYPE_MEMBER_FUNCTION: return CLASS_TRACE_MEMBER_FUNCTION;
+	}
+
+	DEBUG_BREAK("unknown function type!");
+	return CLASS_TRACE_MEMBER_FUNCTION;
+}
+
+static Class* function_dispatch(const Function* function, const Class* klass, const Class* other)
+{
+	const FunctionType type = function_get_type(function);
+
+	// a function may only have some of its forms, an allocating call of an in-place only function creates the result
+	switch (type) {
+		case FUNCTION_TYPE_CONSTRUCTOR:
+		case FUNCTION_TYPE_DESTRUCTOR:
+			if (function->fn != NULL) {
+				function->fn(klass);
+			}
+			return NULL;
+		case FUNCTION_TYPE_MEMBER_FUNCTION: {
+			if (other == NULL) {
+				if (function->fn == NULL) {
+					DEBUG_BREAK("function has no unary form!");
+					return NULL;
+				}
+				function->fn(klass);
+				return NULL;
+			}
+
+			if (function->binary_member_fn != NULL) {
+				return function->binary_member_fn(klass, other);
+			}
+
+			if (function->binary_member_into_fn == NULL) {
+				DEBUG_BREAK("function has no binary form!");
+				return NULL;
+			}
+
+			Class* result = class_create(klass->type);
+			if (result != NULL) {
+				function->binary_member_into_fn(result, klass, other);
+			}
+			return result;
+		}
+	}
+
+	DEBUG_BREAK("unknown function type!");
+	return NULL;
+}
+
+// the type is read up front, a destructor may leave nothing valid behind but the header
+static Class* function_invoke_traced(const Function* function, const Class* klass, const Class* other)
+{
+	const NameAtom type = klass->type != NULL ? klass->type->atom : NAME_ATOM_NONE;
+	const uint64_t begin = class_trace_now();
+	Class* result = function_dispatch(function, klass, other);
+	class_trace_record(class_trace_get_kind(function->type), type, function->atom, begin);
+	return result;
+}
+
+Class* function_invoke(const Function* function, const Class* klass, const Class* other)
+{
+	if (function == NULL || klass == NULL) {
+		DEBUG_BREAK("invalid function!");
+		return NULL;
+	}
+
+	if (CLASS_TRACING()) {
+		return function_invoke_traced(function, klass, other);
+	}
+
+	return function_dispatch(function, klass, other);
+}
+
+// writes the result of a binary member function into out instead of allocating it
+void function_invoke_into(const Function* function, Class* out, const Class* klass, const Class* other)
+{
+	if (function == NULL || out == NULL || klass == NULL || other == NULL) {
+		DEBUG_BREAK("invalid function!");
+		return;
+	}
+
+	if (function_get_type(function) != FUNCTION_TYPE_MEMBER_FUNCTION || function->binary_member_into_fn == NULL) {
+		DEBUG_BREAK("function has no in-place form!");
+		return;
+	}
+
+	if (CLASS_TRACING()) {
+		const uint64_t begin = class_trace_now();
+		function->binary_member_into_fn(out, klass, other);
+		class_trace_record(CLASS_TRACE_MEMBER_FUNCTION, klass->type != NULL ? klass->type->atom : NAME_ATOM_NONE, function->atom, begin);
+		return;
+	}
+
+	function->binary_member_into_fn(out, klass, other);
+}
+
+static void* default_alloc(void* user_data, size_t size, size_t alignment)
+{
+	return ALIGNED_MALLOC(size, alignment);
+}
+
+static void default_free(void* user_data, void* memory)
+{
+	ALIGNED_FREE(memory);
+}
+
+static const Allocator s_default_allocator = { default_alloc, default_free, NULL };
+
+void* allocator_alloc(const Allocator* allocator, size_t size)
+{
+	return allocator_alloc_aligned(allocator, size, ALLOCATOR_ALIGNMENT);
+}
+
+void* allocator_alloc_aligned(const Allocator* allocator, size_t size, size_t alignment)
+{
+	if (allocator == NULL) {
+		allocator = allocator_get_default();
+	}
+
+	if (alignment < ALLOCATOR_ALIGNMENT) {
+		alignment = ALLOCATOR_ALIGNMENT;
+	}
+
+	return allocator->alloc(allocator->user_data, size, alignment);
+}
+
+void allocator_free(const Allocator* allocator, void* memory)
+{
+	if (memory == NULL) {
+		return;
+	}
+
+	if (allocator == NULL) {
+		allocator = allocator_get_default();
+	}
+
+	allocator->free(allocator->user_data, memory);
+}
+
+const Allocator* allocator_get_default(void)
+{
+	return &s_default_allocator;
+}
+
+static void* pool_allocator_alloc(void* user_data, size_t size, size_t alignment)
+{
+	Pool* pool = (Pool*)user_data;
+	if (size > pool->block_size) {
+		DEBUG_BREAK("allocation is larger than the pool block size!");
+		return NULL;
+	}
+
+	if (alignment > pool->alignment) {
+		DEBUG_BREAK("allocation is more aligned than the pool blocks!");
+		return NULL;
+	}
+
+	return pool_alloc(pool);
+}
+
+static void pool_allocator_free(void* user_data, void* memory)
+{
+	pool_free((Pool*)user_data, memory);
+}
+
+Pool* pool_create(size_t block_size, size_t blocks_per_chunk)
+{
+	return pool_create_aligned(block_size, blocks_per_chunk, ALLOCATOR_ALIGNMENT);
+}
+
+// blocks start on multiples of alignment, which has to be a power of two
+Pool* pool_create_aligned(size_t block_size, size_t blocks_per_chunk, size_t alignment)
+{
+	if (block_size == 0 || blocks_per_chunk == 0) {
+		DEBUG_BREAK("invalid pool size!");
+		return NULL;
+	}
+
+	if (alignment < ALLOCATOR_ALIGNMENT) {
+		alignment = ALLOCATOR_ALIGNMENT;
+	}
+
+	Pool* pool = (Pool*)malloc(sizeof(Pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	// every block has to be able to hold the free list link
+	if (block_size < sizeof(void*)) {
+		block_size = sizeof(void*);
+	}
+
+	pool->block_size = ALIGN_UP(block_size, alignment);
+	pool->blocks_per_chunk = blocks_per_chunk;
+	pool->alignment = alignment;
+	pool->free_list = NULL;
+	pool->chunks = NULL;
+	pool->allocator.alloc = pool_allocator_alloc;
+	pool->allocator.free = pool_allocator_free;
+	pool->allocator.user_data = pool;
+
+	return pool;
+}
+
+void pool_destroy(Pool* pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	PoolChunk* chunk = pool->chunks;
+	while (chunk != NULL) {
+		PoolChunk* next = chunk->next;
+		ALIGNED_FREE(chunk);
+		chunk = next;
+	}
+
+	free(pool);
+}
+
+void* pool_alloc(Pool* pool)
+{
+	if (pool == NULL) {
+		DEBUG_BREAK("invalid pool!");
+		return NULL;
+	}
+
+	if (pool->free_list == NULL) {
+		const size_t header_size = ALIGN_UP(sizeof(PoolChunk), pool->alignment);
+		PoolChunk* chunk = (PoolChunk*)ALIGNED_MALLOC(header_size + pool->block_size * pool->blocks_per_chunk, pool->alignment);
+		if (chunk == NULL) {
+			return NULL;
+		}
+
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+
+		// thread the new blocks onto the free list back to front so they are handed out in address order
+		unsigned char* blocks = (unsigned char*)chunk + header_size;
+		for (size_t i = pool->blocks_per_chunk; i > 0; i--) {
+			void* block = blocks + pool->block_size * (i - 1);
+			*(void**)block = pool->free_list;
+			pool->free_list = block;
+		}
+	}
+
+	void* block = pool->free_list;
+	pool->free_list = *(void**)block;
+	return block;
+}
+
+void pool_free(Pool* pool, void* memory)
+{
+	if (pool == NULL || memory == NULL) {
+		return;
+	}
+
+	*(void**)memory = pool->free_list;
+	pool->free_list = memory;
+}
+
+const Allocator* pool_get_allocator(const Pool* pool)
+{
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	return &pool->allocator;
+}
+
+static void* arena_allocator_alloc(void* user_data, size_t size, size_t alignment)
+{
+	return arena_alloc_aligned((Arena*)user_data, size, alignment);
+}
+
+static void arena_allocator_free(void* user_data, void* memory)
+{
+	
+}
+
+Arena* arena_create(size_t capacity)
+{
+	Arena* arena = (Arena*)malloc(sizeof(Arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	arena->buffer = (unsigned char*)malloc(capacity);
+	if (arena->buffer == NULL) {
+		free(arena);
+		return NULL;
+	}
+
+	arena->capacity = capacity;
+	arena->offset = 0;
+	arena->allocator.alloc = arena_allocator_alloc;
+	arena->allocator.free = arena_allocator_free;
+	arena->allocator.user_data = arena;
+
+	return arena;
+}
+
+void arena_destroy(Arena* arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	free(arena->buffer);
+	free(arena);
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+	return arena_alloc_aligned(arena, size, ALLOCATOR_ALIGNMENT);
+}
+
+// the address is aligned rather than the offset, the buffer itself is only malloc aligned
+void* arena_alloc_aligned(Arena* arena, size_t size, size_t alignment)
+{
+	if (arena == NULL) {
+		DEBUG_BREAK("invalid arena!");
+		return NULL;
+	}
+
+	const uintptr_t base = (uintptr_t)arena->buffer;
+	const size_t offset = (size_t)(ALIGN_UP(base + arena->offset, alignment) - base);
+	if (offset + size > arena->capacity) {
+		return NULL;
+	}
+
+	arena->offset = offset + size;
+	return arena->buffer + offset;
+}
+
+// destructors of instances living in the arena are not run
+void arena_reset(Arena* arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	arena->offset = 0;
+}
+
+size_t arena_get_used(const Arena* arena)
+{
+	if (arena == NULL) {
+		return 0;
+	}
+
+	return arena->offset;
+}
+
+const Allocator* arena_get_allocator(const Arena* arena)
+{
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	return &arena->allocator;
+}
+
+// 32 bit FNV-1a
+uint32_t name_hash(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	for (const unsigned char* c = (const unsigned char*)name; *c != '\0'; c++) {
+		hash ^= *c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// the string and hash of atom n live at index n - 1 of the entry chunks, chunk k holds NAME_CHUNK_BASE << k entries.
+// chunks never move and a grown slot table only replaces the published one, so readers never lock,
+// every retired slot table is kept until name_intern_shutdown
+#define NAME_CHUNK_BASE 64u
+#define NAME_CHUNK_COUNT 26u
+
+typedef struct NameEntry {
+	char* string;
+	uint32_t hash;
+} NameEntry;
+
+typedef struct NameSlotTable {
+	struct NameSlotTable* retired;
+	size_t capacity;
+	_Atomic(NameAtom) slots[];
+} NameSlotTable;
+
+typedef struct NameInternTable {
+	mtx_t lock;
+	_Atomic(NameSlotTable*) table;
+	NameEntry* chunks[NAME_CHUNK_COUNT];
+	atomic_size_t count;
+} NameInternTable;
+
+static NameInternTable s_names;
+static once_flag s_names_once = ONCE_FLAG_INIT;
+
+static void name_intern_init(void)
+{
+	mtx_init(&s_names.lock, mtx_plain);
+}
+
+static NameEntry* name_intern_get_entry(size_t index)
+{
+	size_t chunk = 0;
+	while (index >= ((size_t)NAME_CHUNK_BASE << chunk)) {
+		index -= (size_t)NAME_CHUNK_BASE << chunk;
+		chunk++;
+	}
+
+	return &s_names.chunks[chunk][index];
+}
+
+// safe without the lock, an atom is only stored in a slot once its entry is written
+static NameAtom name_intern_find(const char* name, uint32_t hash)
+{
+	const NameSlotTable* table = atomic_load_explicit(&s_names.table, memory_order_acquire);
+	if (table == NULL) {
+		return NAME_ATOM_NONE;
+	}
+
+	const size_t mask = table->capacity - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		const NameAtom atom = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+		if (atom == NAME_ATOM_NONE) {
+			return NAME_ATOM_NONE;
+		}
+		const NameEntry* entry = name_intern_get_entry(atom - 1);
+		if (entry->hash == hash && strcmp(entry->string, name) == 0) {
+			return atom;
+		}
+	}
+}
+
+static void name_slot_table_insert(NameSlotTable* table, NameAtom atom, uint32_t hash)
+{
+	size_t slot = hash & (table->capacity - 1);
+	while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed) != NAME_ATOM_NONE) {
+		slot = (slot + 1) & (table->capacity - 1);
+	}
+	atomic_store_explicit(&table->slots[slot], atom, memory_order_release);
+}
+
+static int name_intern_grow_locked(void)
+{
+	const size_t count = atomic_load_explicit(&s_names.count, memory_order_relaxed);
+
+	// the first index past the allocated chunks is always the start of the next chunk
+	size_t chunk = 0;
+	size_t chunk_start = 0;
+	while (chunk < NAME_CHUNK_COUNT && s_names.chunks[chunk] != NULL) {
+		chunk_start += (size_t)NAME_CHUNK_BASE << chunk;
+		chunk++;
+	}
+	if (count == chunk_start) {
+		if (chunk == NAME_CHUNK_COUNT) {
+			return 0;
+		}
+		s_names.chunks[chunk] = (NameEntry*)malloc(sizeof(NameEntry) * ((size_t)NAME_CHUNK_BASE << chunk));
+		if (s_names.chunks[chunk] == NULL) {
+			return 0;
+		}
+	}
+
+	// same one half load factor as the per-type tables
+	NameSlotTable* table = atomic_load_explicit(&s_names.table, memory_order_relaxed);
+	const size_t capacity = table != NULL ? table->capacity : 0;
+	if ((count + 1) * 2 <= capacity) {
+		return 1;
+	}
+
+	const size_t new_capacity = capacity > 0 ? capacity * 2 : 128;
+	NameSlotTable* grown = (NameSlotTable*)calloc(1, sizeof(NameSlotTable) + sizeof(NameAtom) * new_capacity);
+	if (grown == NULL) {
+		return 0;
+	}
+
+	grown->retired = table;
+	grown->capacity = new_capacity;
+	for (size_t i = 0; i < count; i++) {
+		name_slot_table_insert(grown, (NameAtom)(i + 1), name_intern_get_entry(i)->hash);
+	}
+
+	atomic_store_explicit(&s_names.table, grown, memory_order_release);
+	return 1;
+}
+
+// returns the atom of name, copying it into the table the first time it is seen
+NameAtom name_intern(const char* name)
+{
+	if (name == NULL) {
+		return NAME_ATOM_NONE;
+	}
+
+	const uint32_t hash = name_hash(name);
+	NameAtom atom = name_intern_find(name, hash);
+	if (atom != NAME_ATOM_NONE) {
+		return atom;
+	}
+
+	call_once(&s_names_once, name_intern_init);
+
+	// another thread may have inserted the name since the unlocked find
+	mtx_lock(&s_names.lock);
+	atom = name_intern_find(name, hash);
+	if (atom == NAME_ATOM_NONE && name_intern_grow_locked() == 1) {
+		const size_t length = strlen(name) + 1;
+		char* copy = (char*)malloc(length);
+		if (copy != NULL) {
+			memcpy(copy, name, length);
+			const size_t count = atomic_load_explicit(&s_names.count, memory_order_relaxed);
+			NameEntry* entry = name_intern_get_entry(count);
+			entry->string = copy;
+			entry->hash = hash;
+			atom = (NameAtom)(count + 1);
+			atomic_store_explicit(&s_names.count, count + 1, memory_order_release);
+			name_slot_table_insert(atomic_load_explicit(&s_names.table, memory_order_relaxed), atom, hash);
+		}
+	}
+	mtx_unlock(&s_names.lock);
+
+	return atom;
+}
+
+// like name_intern but never inserts, a name nothing was declared with has no atom
+NameAtom name_lookup(const char* name)
+{
+	if (name == NULL) {
+		return NAME_ATOM_NONE;
+	}
+
+	return name_intern_find(name, name_hash(name));
+}
+
+const char* name_atom_get_string(NameAtom atom)
+{
+	if (atom == NAME_ATOM_NONE || atom > atomic_load_explicit(&s_names.count, memory_order_acquire)) {
+		return NULL;
+	}
+
+	return name_intern_get_entry(atom - 1)->string;
+}
+
+size_t name_intern_get_count(void)
+{
+	return atomic_load_explicit(&s_names.count, memory_order_acquire);
+}
+
+// only call once every type has been destroyed and no thread is reading names, their names point into the table
+void name_intern_shutdown(void)
+{
+	call_once(&s_names_once, name_intern_init);
+
+	mtx_lock(&s_names.lock);
+	const size_t count = atomic_load_explicit(&s_names.count, memory_order_relaxed);
+	for (size_t i = 0; i < count; i++) {
+		free(name_intern_get_entry(i)->string);
+	}
+	for (size_t i = 0; i < NAME_CHUNK_COUNT; i++) {
+		free(s_names.chunks[i]);
+		s_names.chunks[i] = NULL;
+	}
+
+	NameSlotTable* table = atomic_load_explicit(&s_names.table, memory_order_relaxed);
+	while (table != NULL) {
+		NameSlotTable* retired = table->retired;
+		free(table);
+		table = retired;
+	}
+	atomic_store_explicit(&s_names.table, NULL, memory_order_relaxed);
+	atomic_store_explicit(&s_names.count, 0, memory_order_relaxed);
+	mtx_unlock(&s_names.lock);
+}
+
+// atoms are dense small integers, a multiplicative hash spreads them over the table
+static size_t name_table_slot(NameAtom atom, size_t mask)
+{
+	return (size_t)(atom * 2654435761u) & mask;
+}
+
+static NameAtom name_table_element_atom(const void* elements, size_t stride, size_t atom_offset, size_t index)
+{
+	const unsigned char* element = (const unsigned char*)elements + stride * index;
+	NameAtom atom;
+	memcpy(&atom, element + atom_offset, sizeof(atom));
+	return atom;
+}
+
+int name_table_build(NameTable* table, const void* elements, size_t count, size_t stride, size_t atom_offset)
+{
+	if (table == NULL) {
+		DEBUG_BREAK("invalid name table!");
+		return 0;
+	}
+
+	name_table_free(table);
+
+	if (count == 0) {
+		return 1;
+	}
+
+	// keep the load factor at or below one half so probe sequences stay short
+	size_t capacity = 8;
+	while (capacity < count * 2) {
+		capacity *= 2;
+	}
+
+	table->entries = (NameTableEntry*)malloc(sizeof(NameTableEntry) * capacity);
+	if (table->entries == NULL) {
+		return 0;
+	}
+
+	table->capacity = capacity;
+	for (size_t i = 0; i < capacity; i++) {
+		table->entries[i].atom = NAME_ATOM_NONE;
+		table->entries[i].index = NAME_TABLE_EMPTY;
+	}
+
+	const size_t mask = capacity - 1;
+	for (size_t i = 0; i < count; i++) {
+		const NameAtom atom = name_table_element_atom(elements, stride, atom_offset, i);
+		if (atom == NAME_ATOM_NONE) {
+			continue;
+		}
+
+		// the first element with a given name wins
+		if (name_table_find(table, atom) != CLASS_INVALID_SLOT) {
+			continue;
+		}
+
+		size_t slot = name_table_slot(atom, mask);
+		while (table->entries[slot].index != NAME_TABLE_EMPTY) {
+			slot = (slot + 1) & mask;
+		}
+
+		table->entries[slot].atom = atom;
+		table->entries[slot].index = (uint32_t)i;
+	}
+
+	return 1;
+}
+
+void name_table_free(NameTable* table)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	free(table->entries);
+	table->entries = NULL;
+	table->capacity = 0;
+}
+
+// every probe is a single integer compare
+size_t name_table_find(const NameTable* table, NameAtom atom)
+{
+	if (table == NULL || atom == NAME_ATOM_NONE || table->capacity == 0) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	const size_t mask = table->capacity - 1;
+	for (size_t slot = name_table_slot(atom, mask); table->entries[slot].index != NAME_TABLE_EMPTY; slot = (slot + 1) & mask) {
+		if (table->entries[slot].atom == atom) {
+			return table->entries[slot].index;
+		}
+	}
+
+	return CLASS_INVALID_SLOT;
+}
+
+static ClassStatCounters s_global_stats;
+
+static void class_stat_counters_reset(ClassStatCounters* counters)
+{
+	atomic_init(&counters->live_instances, 0);
+	atomic_init(&counters->total_allocations, 0);
+	atomic_init(&counters->total_frees, 0);
+	atomic_init(&counters->bytes_in_use, 0);
+	atomic_init(&counters->peak_bytes_in_use, 0);
+	atomic_init(&counters->ctor_calls, 0);
+	atomic_init(&counters->copy_calls, 0);
+	atomic_init(&counters->dtor_calls, 0);
+}
+
+static ClassStats class_stat_counters_snapshot(ClassStatCounters* counters)
+{
+	ClassStats stats;
+	stats.live_instances = atomic_load_explicit(&counters->live_instances, memory_order_relaxed);
+	stats.total_allocations = atomic_load_explicit(&counters->total_allocations, memory_order_relaxed);
+	stats.total_frees = atomic_load_explicit(&counters->total_frees, memory_order_relaxed);
+	stats.bytes_in_use = atomic_load_explicit(&counters->bytes_in_use, memory_order_relaxed);
+	stats.peak_bytes_in_use = atomic_load_explicit(&counters->peak_bytes_in_use, memory_order_relaxed);
+	stats.ctor_calls = atomic_load_explicit(&counters->ctor_calls, memory_order_relaxed);
+	stats.copy_calls = atomic_load_explicit(&counters->copy_calls, memory_order_relaxed);
+	stats.dtor_calls = atomic_load_explicit(&counters->dtor_calls, memory_order_relaxed);
+	return stats;
+}
+
+#if CLASS_ENABLE_STATS
+static void class_stats_on_alloc(ClassStatCounters* counters, size_t size)
+{
+	atomic_fetch_add_explicit(&counters->total_allocations, 1, memory_order_relaxed);
+	const size_t in_use = atomic_fetch_add_explicit(&counters->bytes_in_use, size, memory_order_relaxed) + size;
+
+	size_t peak = atomic_load_explicit(&counters->peak_bytes_in_use, memory_order_relaxed);
+	while (in_use > peak && !atomic_compare_exchange_weak_explicit(&counters->peak_bytes_in_use, &peak, in_use, memory_order_relaxed, memory_order_relaxed)) {
+	}
+}
+
+static void class_stats_on_free(ClassStatCounters* counters, size_t size)
+{
+	atomic_fetch_add_explicit(&counters->total_frees, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&counters->bytes_in_use, size, memory_order_relaxed);
+}
+
+// one call for every level of the base chain that has the function. once every instance is destroyed
+// ctor_calls + copy_calls == dtor_calls for a type whose levels with a dtor also have a ctor and a copy function
+static void class_stats_on_construct(ClassStatCounters* counters, size_t ctor_calls)
+{
+	atomic_fetch_add_explicit(&counters->live_instances, 1, memory_order_relaxed);
+	if (ctor_calls > 0) {
+		atomic_fetch_add_explicit(&counters->ctor_calls, ctor_calls, memory_order_relaxed);
+	}
+}
+
+static void class_stats_on_copy(ClassStatCounters* counters, size_t copy_calls)
+{
+	atomic_fetch_add_explicit(&counters->live_instances, 1, memory_order_relaxed);
+	if (copy_calls > 0) {
+		atomic_fetch_add_explicit(&counters->copy_calls, copy_calls, memory_order_relaxed);
+	}
+}
+
+static void class_stats_on_destruct(ClassStatCounters* counters, size_t dtor_calls)
+{
+	atomic_fetch_sub_explicit(&counters->live_instances, 1, memory_order_relaxed);
+	if (dtor_calls > 0) {
+		atomic_fetch_add_explicit(&counters->dtor_calls, dtor_calls, memory_order_relaxed);
+	}
+}
+
+static size_t class_type_count_ctors(const ClassType* type)
+{
+	size_t count = 0;
+	for (; type != NULL; type = type->base) {
+		count += type->ctor.fn != NULL;
+	}
+
+	return count;
+}
+
+static size_t class_type_count_dtors(const ClassType* type)
+{
+	size_t count = 0;
+	for (; type != NULL; type = type->base) {
+		count += type->dtor.fn != NULL;
+	}
+
+	return count;
+}
+
+static size_t class_type_count_copies(const ClassType* type)
+{
+	size_t count = 0;
+	for (; type != NULL; type = type->base) {
+		count += type->copy != NULL;
+	}
+
+	return count;
+}
+#endif
+
+// all zero when the library is built without CLASS_ENABLE_STATS
+ClassStats class_stats_get_global(void)
+{
+	return class_stat_counters_snapshot(&s_global_stats);
+}
+
+void class_stats_reset_global(void)
+{
+	class_stat_counters_reset(&s_global_stats);
+}
+
+void class_stats_debug_print(const char* label, const ClassStats* stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	printf("Stats: %s\n", label != NULL ? label : "(null)");
+	printf("\tLive Instances: %zu\n", stats->live_instances);
+	printf("\tAllocations: %zu\n", stats->total_allocations);
+	printf("\tFrees: %zu\n", stats->total_frees);
+	printf("\tBytes In Use: %zu\n", stats->bytes_in_use);
+	printf("\tPeak Bytes In Use: %zu\n", stats->peak_bytes_in_use);
+	printf("\tCtor Calls: %zu\n", stats->ctor_calls);
+	printf("\tCopy Calls: %zu\n", stats->copy_calls);
+	printf("\tDtor Calls: %zu\n", stats->dtor_calls);
+}
+
+// types keep their own copy of every name out of the intern table, so names built on the stack are safe
+static char* class_type_intern_name(const char* name, NameAtom* atom)
+{
+	*atom = name_intern(name);
+	return (char*)name_atom_get_string(*atom);
+}
+
+static int class_type_rebuild_name_tables(ClassType* type)
+{
+	const int members_built = name_table_build(&type->member_table, type->members, type->num_members, sizeof(Member), offsetof(Member, atom));
+	const int functions_built = name_table_build(&type->function_table, type->functions, type->num_functions, sizeof(Function), offsetof(Function, atom));
+	return members_built && functions_built;
+}
+
+#define CLASS_SCHEMA_HASH_SEED 14695981039346656037ull
+
+// fnv-1a over the stored members only, archives hash their member table the same way.
+// the payload size is left out so computed members and cache line padding do not change it
+static uint64_t class_schema_hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static uint64_t class_schema_hash_member(uint64_t hash, uint32_t type, uint32_t offset, uint32_t count, const char* name, uint32_t name_length)
+{
+	hash = class_schema_hash_bytes(hash, &type, sizeof(type));
+	hash = class_schema_hash_bytes(hash, &offset, sizeof(offset));
+	hash = class_schema_hash_bytes(hash, &count, sizeof(count));
+	hash = class_schema_hash_bytes(hash, &name_length, sizeof(name_length));
+	return class_schema_hash_bytes(hash, name, name_length);
+}
+
+// unnamed members are allowed, their name hashes and is stored as an empty string
+static size_t class_name_length(const char* name)
+{
+	return name != NULL ? strlen(name) : 0;
+}
+
+static void class_type_compute_schema_hash(ClassType* type)
+{
+	uint64_t hash = CLASS_SCHEMA_HASH_SEED;
+	for (size_t i = 0; i < type->num_members; i++) {
+		const Member* member = &type->members[i];
+		hash = class_schema_hash_member(hash, (uint32_t)member->type, member->offset, member->count, member->name, (uint32_t)class_name_length(member->name));
+	}
+
+	type->schema_hash = hash;
+}
+
+// merges members that continue the previous run with lanes of the same type
+static int class_type_compute_lane_runs(ClassType* type)
+{
+	free(type->lane_runs);
+	type->lane_runs = NULL;
+	type->num_lane_runs = 0;
+	if (type->num_members == 0) {
+		return 1;
+	}
+
+	type->lane_runs = (ClassLaneRun*)malloc(sizeof(ClassLaneRun) * type->num_members);
+	if (type->lane_runs == NULL) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < type->num_members; i++) {
+		const Member* member = &type->members[i];
+		const MemberType lane_type = member_type_get_lane_type(member->type);
+		const size_t lane_size = member_type_get_size(lane_type);
+		const uint32_t lanes = (uint32_t)(member_get_size(member) / lane_size);
+
+		ClassLaneRun* last = type->num_lane_runs > 0 ? &type->lane_runs[type->num_lane_runs - 1] : NULL;
+		if (last != NULL && last->lane_type == lane_type && last->offset + last->lanes * lane_size == member->offset) {
+			last->lanes += lanes;
+			continue;
+		}
+
+		ClassLaneRun* run = &type->lane_runs[type->num_lane_runs++];
+		run->lane_type = lane_type;
+		run->offset = member->offset;
+		run->lanes = lanes;
+	}
+
+	return 1;
+}
+
+// assigns member offsets in declaration order and builds the payload new instances are initialized from
+static int class_type_compute_layout(ClassType* type)
+{
+	size_t offset = 0;
+	size_t alignment = 1;
+	size_t first_member = 0;
+
+	// inherited members keep the base offsets, new members start after the stored base members.
+	// computed members are not inherited, so neither is the base cache
+	if (type->base != NULL) {
+		offset = type->base->cache_offset;
+		alignment = type->base->payload_alignment;
+		first_member = type->num_base_members;
+	}
+
+	for (size_t i = first_member; i < type->num_members; i++) {
+		Member* member = &type->members[i];
+		const size_t size = member_get_size(member);
+		const size_t member_alignment = member_get_alignment(member);
+		offset = ALIGN_UP(offset, member_alignment);
+		member->offset = (uint32_t)offset;
+		offset += size;
+		if (member_alignment > alignment) {
+			alignment = member_alignment;
+		}
+	}
+
+	// computed values are cached after the stored members
+	offset = ALIGN_UP(offset, alignment);
+	type->cache_offset = offset;
+	for (size_t i = 0; i < type->num_computed; i++) {
+		ComputedMember* computed = &type->computed[i];
+		const size_t computed_alignment = member_type_get_alignment(computed->type);
+		offset = ALIGN_UP(offset, computed_alignment);
+		computed->offset = (uint32_t)offset;
+		offset += member_type_get_size(computed->type);
+		if (computed_alignment > alignment) {
+			alignment = computed_alignment;
+		}
+	}
+
+	type->payload_size = ALIGN_UP(offset, alignment);
+	type->payload_alignment = alignment;
+	type->payload_offset = ALIGN_UP(sizeof(Class), alignment);
+
+	// pad whole instances out to cache lines so neighbours in a pool never share one
+	if (type->cache_line_padded == 1) {
+		type->payload_size = ALIGN_UP(type->payload_offset + type->payload_size, CLASS_CACHE_LINE_SIZE) - type->payload_offset;
+	}
+
+	if (class_type_compute_lane_runs(type) == 0) {
+		return 0;
+	}
+	class_type_compute_schema_hash(type);
+
+	free(type->default_payload);
+	type->default_payload = NULL;
+	if (type->payload_size == 0) {
+		return 1;
+	}
+
+	type->default_payload = (unsigned char*)calloc(1, type->payload_size);
+	if (type->default_payload == NULL) {
+		return 0;
+	}
+
+	// members wider than MemberData always start out zeroed
+	for (size_t i = 0; i < type->num_members; i++) {
+		const Member* member = &type->members[i];
+		if (member_type_fits_data(member->type) == 1) {
+			member_data_store(member->type, type->default_payload + member->offset, member->data);
+		}
+	}
+
+	return 1;
+}
+
+// a function named like an inherited one overrides it in the same slot
+static size_t class_type_find_override_slot(const ClassType* type, NameAtom atom)
+{
+	const size_t num_base_functions = type->base != NULL ? type->base->num_functions : 0;
+	for (size_t i = 0; i < num_base_functions && i < type->num_functions; i++) {
+		if (atom != NAME_ATOM_NONE && type->functions[i].atom == atom) {
+			return i;
+		}
+	}
+
+	return CLASS_INVALID_SLOT;
+}
+
+ClassType* class_type_create(const ClassCreateInfo* createInfo)
+{
+	ClassType* type = (ClassType*)malloc(sizeof(ClassType));
+	if (type == NULL) {
+		return NULL;
+	}
+
+	type->name = class_type_intern_name(createInfo->name, &type->atom);
+	type->base = createInfo->base;
+	type->num_base_members = createInfo->base != NULL ? createInfo->base->num_members : 0;
+
+	if (createInfo->allocator != NULL) {
+		type->allocator = *createInfo->allocator;
+	} else {
+		type->allocator = *allocator_get_default();
+	}
+	type->copy = createInfo->copy;
+
+	if (createInfo->ctor != NULL) {
+		type->ctor.fn = createInfo->ctor->fn;
+		type->ctor.binary_member_fn = NULL;
+		type->ctor.binary_member_into_fn = NULL;
+		type->ctor.batch_fn = NULL;
+		type->ctor.name = class_type_intern_name(createInfo->ctor->name, &type->ctor.atom);
+		type->ctor.type = FUNCTION_TYPE_CONSTRUCTOR;
+	} else {
+		type->ctor.fn = NULL;
+		type->ctor.binary_member_fn = NULL;
+		type->ctor.binary_member_into_fn = NULL;
+		type->ctor.batch_fn = NULL;
+		type->ctor.name = NULL;
+		type->ctor.atom = NAME_ATOM_NONE;
+		type->ctor.type = FUNCTION_TYPE_CONSTRUCTOR;
+	}
+
+	if (createInfo->dtor != NULL) {
+		type->dtor.fn = createInfo->dtor->fn;
+		type->dtor.binary_member_fn = NULL;
+		type->dtor.binary_member_into_fn = NULL;
+		type->dtor.batch_fn = NULL;
+		type->dtor.name = class_type_intern_name(createInfo->dtor->name, &type->dtor.atom);
+		type->dtor.type = FUNCTION_TYPE_DESTRUCTOR;
+	} else {
+		type->dtor.fn = NULL;
+		type->dtor.binary_member_fn = NULL;
+		type->dtor.binary_member_into_fn = NULL;
+		type->dtor.batch_fn = NULL;
+		type->dtor.name = NULL;
+		type->dtor.atom = NAME_ATOM_NONE;
+		type->dtor.type = FUNCTION_TYPE_DESTRUCTOR;
+	}
+
+	type->members = NULL;
+	type->num_members = 0;
+	type->member_capacity = 0;
+	type->functions = NULL;
+	type->num_functions = 0;
+	type->function_capacity = 0;
+	type->member_table.entries = NULL;
+	type->member_table.capacity = 0;
+	type->function_table.entries = NULL;
+	type->function_table.capacity = 0;
+	type->payload_size = 0;
+	type->payload_alignment = 1;
+	type->payload_offset = sizeof(Class);
+	type->computed = NULL;
+	type->num_computed = 0;
+	type->cache_offset = 0;
+	type->lane_runs = NULL;
+	type->num_lane_runs = 0;
+	type->operators.add = class_add_into;
+	type->operators.sub = class_sub_into;
+	type->operators.mul = class_mul_into;
+	type->operators.scale = class_scale_into;
+	type->operators.dot = class_dot;
+	type->schema_version = 0;
+	type->schema_hash = 0;
+	type->default_payload = NULL;
+	type->cache_line_padded = createInfo->cache_line_padded != 0;
+	class_stat_counters_reset(&type->stats);
+
+	const size_t num_base_functions = type->base != NULL ? type->base->num_functions : 0;
+	const size_t member_capacity = type->num_base_members + createInfo->num_members;
+	const size_t function_capacity = num_base_functions + createInfo->num_functions;
+	if (class_type_reserve(type, member_capacity, function_capacity) == 0) {
+		class_type_destroy(type);
+		return NULL;
+	}
+
+	// the base members and vtable are flattened into the derived type up front
+	for (size_t i = 0; i < type->num_base_members; i++) {
+		type->members[i] = type->base->members[i];
+		type->members[i].invalidates = 0;
+	}
+	type->num_members = type->num_base_members;
+
+	for (size_t i = 0; i < num_base_functions; i++) {
+		type->functions[i] = type->base->functions[i];
+	}
+	type->num_functions = num_base_functions;
+
+	for (size_t i = 0; i < createInfo->num_members; i++) {
+		Member* member = &type->members[type->num_members++];
+		const Member* other = &createInfo->members[i];
+		member->name = class_type_intern_name(other->name, &member->atom);
+		member->type = other->type;
+		member->data = other->data;
+		member->count = other->count;
+		member->invalidates = 0;
+	}
+
+	for (size_t i = 0; i < createInfo->num_functions; i++) {
+		const Function* other = &createInfo->functions[i];
+		NameAtom atom = NAME_ATOM_NONE;
+		char* name = class_type_intern_name(other->name, &atom);
+
+		size_t slot = class_type_find_override_slot(type, atom);
+		if (slot == CLASS_INVALID_SLOT) {
+			slot = type->num_functions;
+			type->num_functions++;
+		}
+
+		Function* function = &type->functions[slot];
+		function->fn = other->fn;
+		function->binary_member_fn = other->binary_member_fn;
+		function->binary_member_into_fn = other->binary_member_into_fn;
+		function->batch_fn = other->batch_fn;
+		function->name = name;
+		function->atom = atom;
+		function->type = other->type;
+	}
+
+	if (class_type_rebuild_name_tables(type) == 0 || class_type_compute_layout(type) == 0) {
+		class_type_destroy(type);
+		return NULL;
+	}
+
+	// descriptors generated by CLASS_DEFINE carry the compiler's layout, it has to agree with ours
+	if (createInfo->payload_size != 0) {
+		int layout_matches = ALIGN_UP(createInfo->payload_size, type->payload_alignment) == type->payload_size || type->cache_line_padded == 1;
+		for (size_t i = 0; i < createInfo->num_members; i++) {
+			layout_matches = layout_matches && type->members[type->num_base_members + i].offset == createInfo->members[i].offset;
+		}
+
+		if (layout_matches == 0) {
+			DEBUG_BREAK("static descriptor layout does not match!");
+			class_type_destroy(type);
+			return NULL;
+		}
+	}
+
+	return type;
+}
+
+void class_type_destroy(ClassType* type)
+{
+	if (type == NULL) {
+		return;
+	}
+
+	name_table_free(&type->member_table);
+	name_table_free(&type->function_table);
+	free(type->default_payload);
+	free(type->members);
+	free(type->functions);
+	free(type->computed);
+	free(type->lane_runs);
+	free(type);
+}
+
+const char* class_type_get_name(const ClassType* type)
+{
+	if (type == NULL) {
+		return NULL;
+	}
+
+	return type->name;
+}
+
+// type identity by name is a single compare of atoms
+NameAtom class_type_get_atom(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, NAME_ATOM_NONE);
+	return type->atom;
+}
+
+size_t class_type_get_instance_size(const ClassType* type)
+{
+	if (type == NULL) {
+		return 0;
+	}
+
+	// an instance is the type pointer followed by the packed payload
+	return ALIGN_UP(type->payload_offset + type->payload_size, class_type_get_instance_alignment(type));
+}
+
+// instances have to be allocated at this alignment for the vector members to be aligned
+size_t class_type_get_instance_alignment(const ClassType* type)
+{
+	if (type == NULL || type->payload_alignment < _Alignof(Class)) {
+		return _Alignof(Class);
+	}
+
+	return type->payload_alignment;
+}
+
+ClassStats class_type_get_stats(const ClassType* type)
+{
+	if (type == NULL) {
+		const ClassStats empty = { 0 };
+		return empty;
+	}
+
+	return class_stat_counters_snapshot(&((ClassType*)type)->stats);
+}
+
+size_t class_type_get_payload_size(const ClassType* type)
+{
+	if (type == NULL) {
+		return 0;
+	}
+
+	return type->payload_size;
+}
+
+const Allocator* class_type_get_allocator(const ClassType* type)
+{
+	if (type == NULL) {
+		return NULL;
+	}
+
+	return &type->allocator;
+}
+
+// a type whose destructor releases something the payload points at needs a copy function,
+// otherwise clones share it with their source and both destructors release it
+void class_type_set_copy_fn(ClassType* type, CopyMemberFn copy)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return;
+	}
+
+	type->copy = copy;
+}
+
+// instances keep no record of their allocator, only switch it while no default-allocated instances are alive
+void class_type_set_allocator(ClassType* type, const Allocator* allocator)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return;
+	}
+
+	if (allocator != NULL) {
+		type->allocator = *allocator;
+	} else {
+		type->allocator = *allocator_get_default();
+	}
+}
+
+// grows the member and function arrays to at least the given capacities, existing contents are kept on failure
+int class_type_reserve(ClassType* type, size_t member_capacity, size_t function_capacity)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return 0;
+	}
+
+	if (member_capacity > type->member_capacity) {
+		Member* members = (Member*)realloc(type->members, sizeof(Member) * member_capacity);
+		if (members == NULL) {
+			return 0;
+		}
+
+		type->members = members;
+		type->member_capacity = member_capacity;
+	}
+
+	if (function_capacity > type->function_capacity) {
+		Function* functions = (Function*)realloc(type->functions, sizeof(Function) * function_capacity);
+		if (functions == NULL) {
+			return 0;
+		}
+
+		type->functions = functions;
+		type->function_capacity = function_capacity;
+	}
+
+	return 1;
+}
+
+static size_t class_type_grow_capacity(size_t capacity, size_t required)
+{
+	size_t new_capacity = capacity > 0 ? capacity : 4;
+	while (new_capacity < required) {
+		new_capacity *= 2;
+	}
+
+	return new_capacity;
+}
+
+// members and functions must be added before any instance of the type is created,
+// instances are sized from the member count at creation time. registered types are also
+// sized by the registry's pools, the registry refuses instances that outgrew them.
+// a failed add leaves the type as it was and returns 0
+int class_type_add_member(ClassType* type, Member* member)
+{
+	if (member == NULL) {
+		DEBUG_BREAK("invalid member!");
+		return 0;
+	}
+
+	return class_type_add_members(type, member, 1);
+}
+
+int class_type_add_members(ClassType* type, const Member* members, size_t count)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return 0;
+	}
+
+	if (members == NULL || count == 0) {
+		return 1;
+	}
+
+	const size_t num_members = class_type_get_num_members(type);
+	if (num_members + count > type->member_capacity) {
+		const size_t capacity = class_type_grow_capacity(type->member_capacity, num_members + count);
+		if (class_type_reserve(type, capacity, type->function_capacity) == 0) {
+			return 0;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		Member* member = &type->members[num_members + i];
+		*member = members[i];
+		member->name = class_type_intern_name(members[i].name, &member->atom);
+		member->invalidates = 0;
+	}
+
+	type->num_members += count;
+	if (class_type_rebuild_name_tables(type) == 0 || class_type_compute_layout(type) == 0) {
+		type->num_members = num_members;
+		class_type_rebuild_name_tables(type);
+		class_type_compute_layout(type);
+		return 0;
+	}
+
+	return 1;
+}
+
+int class_type_add_function(ClassType* type, Function* function)
+{
+	if (function == NULL) {
+		DEBUG_BREAK("invalid function!");
+		return 0;
+	}
+
+	return class_type_add_functions(type, function, 1);
+}
+
+int class_type_add_functions(ClassType* type, const Function* functions, size_t count)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return 0;
+	}
+
+	if (functions == NULL || count == 0) {
+		return 1;
+	}
+
+	const size_t num_functions = class_type_get_num_functions(type);
+	if (num_functions + count > type->function_capacity) {
+		const size_t capacity = class_type_grow_capacity(type->function_capacity, num_functions + count);
+		if (class_type_reserve(type, type->member_capacity, capacity) == 0) {
+			return 0;
+		}
+	}
+
+	// new names are appended first, overrides keep their slot and name so they can not fail
+	for (size_t i = 0; i < count; i++) {
+		NameAtom atom = NAME_ATOM_NONE;
+		char* name = class_type_intern_name(functions[i].name, &atom);
+		if (class_type_find_override_slot(type, atom) != CLASS_INVALID_SLOT) {
+			continue;
+		}
+
+		Function* function = &type->functions[type->num_functions++];
+		*function = functions[i];
+		function->name = name;
+		function->atom = atom;
+	}
+
+	if (type->num_functions != num_functions && class_type_rebuild_name_tables(type) == 0) {
+		type->num_functions = num_functions;
+		class_type_rebuild_name_tables(type);
+		return 0;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		NameAtom atom = NAME_ATOM_NONE;
+		char* name = class_type_intern_name(functions[i].name, &atom);
+		const size_t slot = class_type_find_override_slot(type, atom);
+		if (slot != CLASS_INVALID_SLOT) {
+			type->functions[slot] = functions[i];
+			type->functions[slot].name = name;
+			type->functions[slot].atom = atom;
+		}
+	}
+
+	return 1;
+}
+
+Member* class_type_get_member(const ClassType* type, size_t index)
+{
+	CLASS_CHECK_NULL(type, NULL);
+	CLASS_CHECK(index < type->num_members, "index out of bounds!", NULL);
+	return &type->members[index];
+}
+
+Function* class_type_get_function(const ClassType* type, size_t index)
+{
+	CLASS_CHECK_NULL(type, NULL);
+	CLASS_CHECK(index < type->num_functions, "index out of bounds!", NULL);
+	return &type->functions[index];
+}
+
+// slots are member indices, they stay valid for the lifetime of the type and can be cached by hot paths
+size_t class_type_find_member_slot(const ClassType* type, const char* name)
+{
+	if (type == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	return name_table_find(&type->member_table, name_lookup(name));
+}
+
+size_t class_type_find_function_slot(const ClassType* type, const char* name)
+{
+	if (type == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	return name_table_find(&type->function_table, name_lookup(name));
+}
+
+// skips the intern table entirely, for callers that interned their names up front
+size_t class_type_find_member_slot_atom(const ClassType* type, NameAtom atom)
+{
+	if (type == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	return name_table_find(&type->member_table, atom);
+}
+
+size_t class_type_find_function_slot_atom(const ClassType* type, NameAtom atom)
+{
+	if (type == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	return name_table_find(&type->function_table, atom);
+}
+
+// resolve once outside the loop and call the returned pointer directly
+UnaryMemberFn class_type_get_unary_fn(const ClassType* type, size_t slot)
+{
+	return class_type_vtable_entry(type, slot)->fn;
+}
+
+BinaryMemberFn class_type_get_binary_fn(const ClassType* type, size_t slot)
+{
+	return class_type_vtable_entry(type, slot)->binary_member_fn;
+}
+
+BinaryMemberIntoFn class_type_get_binary_into_fn(const ClassType* type, size_t slot)
+{
+	return class_type_vtable_entry(type, slot)->binary_member_into_fn;
+}
+
+size_t class_type_get_num_members(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, 0);
+	return type->num_members;
+}
+
+size_t class_type_get_num_functions(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, 0);
+	return type->num_functions;
+}
+
+const ClassType* class_type_get_base(const ClassType* type)
+{
+	if (type == NULL) {
+		return NULL;
+	}
+
+	return type->base;
+}
+
+// a derived instance can be passed anywhere an instance of one of its bases is expected
+int class_type_is_a(const ClassType* type, const ClassType* base)
+{
+	for (const ClassType* current = type; current != NULL; current = current->base) {
+		if (current == base) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// like members, computed members must be added before any instance of the type is created.
+// dependencies are member slots, a write to any of them through a setter drops the cached value.
+// returns the computed slot
+size_t class_type_add_computed_member(ClassType* type, const char* name, MemberType member_type, ComputedMemberFn fn, const size_t* dependencies, size_t num_dependencies)
+{
+	if (type == NULL || fn == NULL) {
+		DEBUG_BREAK("invalid computed member!");
+		return CLASS_INVALID_SLOT;
+	}
+
+	if (member_type == MEMBER_TYPE_F32_ARRAY || type->num_computed == CLASS_MAX_COMPUTED_MEMBERS) {
+		DEBUG_BREAK("computed member can not be cached!");
+		return CLASS_INVALID_SLOT;
+	}
+
+	for (size_t i = 0; i < num_dependencies; i++) {
+		if (dependencies[i] >= type->num_members) {
+			DEBUG_BREAK("index out of bounds!");
+			return CLASS_INVALID_SLOT;
+		}
+	}
+
+	ComputedMember* computed = (ComputedMember*)realloc(type->computed, sizeof(ComputedMember) * (type->num_computed + 1));
+	if (computed == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+	type->computed = computed;
+
+	const size_t slot = type->num_computed;
+	ComputedMember* member = &type->computed[slot];
+	member->name = class_type_intern_name(name, &member->atom);
+	member->type = member_type;
+	member->offset = 0;
+	member->dependencies = 0;
+	member->fn = fn;
+
+	for (size_t i = 0; i < num_dependencies; i++) {
+		member->dependencies |= class_member_dirty_bit(dependencies[i]);
+	}
+
+	type->num_computed++;
+	if (class_type_compute_layout(type) == 0) {
+		type->num_computed--;
+		class_type_compute_layout(type);
+		return CLASS_INVALID_SLOT;
+	}
+
+	// the dependencies only start dropping the cached value once the slot exists
+	for (size_t i = 0; i < num_dependencies; i++) {
+		type->members[dependencies[i]].invalidates |= (uint64_t)1 << slot;
+	}
+
+	return slot;
+}
+
+size_t class_type_get_num_computed_members(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, 0);
+	return type->num_computed;
+}
+
+const ComputedMember* class_type_get_computed_member(const ClassType* type, size_t index)
+{
+	CLASS_CHECK_NULL(type, NULL);
+	CLASS_CHECK(index < type->num_computed, "index out of bounds!", NULL);
+	return &type->computed[index];
+}
+
+// computed members are few, a scan over the atoms is enough
+size_t class_type_find_computed_slot(const ClassType* type, const char* name)
+{
+	if (type == NULL) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	const NameAtom atom = name_lookup(name);
+	for (size_t i = 0; i < type->num_computed; i++) {
+		if (atom != NAME_ATOM_NONE && type->computed[i].atom == atom) {
+			return i;
+		}
+	}
+
+	return CLASS_INVALID_SLOT;
+}
+
+// changes whenever a member is added or the layout moves, archives written with another hash are migrated on read
+uint64_t class_type_get_schema_hash(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, 0);
+	return type->schema_hash;
+}
+
+uint32_t class_type_get_schema_version(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, 0);
+	return type->schema_version;
+}
+
+// the version is only recorded in archives for the application's own bookkeeping, migration goes by the layout
+void class_type_set_schema_version(ClassType* type, uint32_t version)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return;
+	}
+
+	type->schema_version = version;
+}
+
+// the table starts out with the generic lane kernels and can be replaced member by member
+const ClassOperators* class_type_get_operators(const ClassType* type)
+{
+	CLASS_CHECK_NULL(type, NULL);
+	return &type->operators;
+}
+
+static Class* class_add(const Class* lhs, const Class* rhs);
+static Class* class_sub(const Class* lhs, const Class* rhs);
+static Class* class_mul(const Class* lhs, const Class* rhs);
+static void class_batch_add(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count);
+static void class_batch_sub(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count);
+static void class_batch_mul(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count);
+
+// appends add, sub and mul member functions in all three forms, names the type already has are kept
+int class_type_add_operator_functions(ClassType* type)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return 0;
+	}
+
+	const Function operators[] = {
+		{ .name = "add", .type = FUNCTION_TYPE_MEMBER_FUNCTION, .binary_member_fn = class_add, .binary_member_into_fn = class_add_into, .batch_fn = class_batch_add },
+		{ .name = "sub", .type = FUNCTION_TYPE_MEMBER_FUNCTION, .binary_member_fn = class_sub, .binary_member_into_fn = class_sub_into, .batch_fn = class_batch_sub },
+		{ .name = "mul", .type = FUNCTION_TYPE_MEMBER_FUNCTION, .binary_member_fn = class_mul, .binary_member_into_fn = class_mul_into, .batch_fn = class_batch_mul },
+	};
+
+	for (size_t i = 0; i < sizeof(operators) / sizeof(Function); i++) {
+		if (class_type_find_function_slot(type, operators[i].name) != CLASS_INVALID_SLOT) {
+			continue;
+		}
+
+		if (class_type_add_functions(type, &operators[i], 1) == 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// base constructors run first and base destructors last, like C++
+static void class_type_construct(const ClassType* type, Class* klass)
+{
+	if (type->base != NULL) {
+		class_type_construct(type->base, klass);
+	}
+
+	if (type->ctor.fn != NULL) {
+		function_invoke(&type->ctor, klass, NULL);
+	}
+}
+
+static uint64_t class_type_all_dirty_mask(const ClassType* type)
+{
+	return type->num_members >= 64 ? UINT64_MAX : class_member_dirty_bit(type->num_members) - 1;
+}
+
+// for writes that replace the whole payload
+static void class_payload_written(Class* klass)
+{
+	klass->dirty |= class_type_all_dirty_mask(klass->type);
+	klass->cached = 0;
+}
+
+static void class_type_copy(const ClassType* type, Class* clone, const Class* source)
+{
+	if (type->base != NULL) {
+		class_type_copy(type->base, clone, source);
+	}
+
+	if (type->copy != NULL) {
+		type->copy(clone, source);
+	}
+}
+
+static void class_type_destruct(const ClassType* type, Class* klass)
+{
+	if (type->dtor.fn != NULL) {
+		function_invoke(&type->dtor, klass, NULL);
+	}
+
+	if (type->base != NULL) {
+		class_type_destruct(type->base, klass);
+	}
+}
+
+Class* class_create(const ClassType* type)
+{
+	return class_create_with_allocator(type, class_type_get_allocator(type));
+}
+
+// the instance must be released with class_destroy_with_allocator and the same allocator
+Class* class_create_with_allocator(const ClassType* type, const Allocator* allocator)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return NULL;
+	}
+
+	const size_t instance_size = class_type_get_instance_size(type);
+	void* memory = allocator_alloc_aligned(allocator, instance_size, class_type_get_instance_alignment(type));
+	if (memory == NULL) {
+		return NULL;
+	}
+
+	CLASS_STAT(class_stats_on_alloc(&((ClassType*)type)->stats, instance_size));
+	CLASS_STAT(class_stats_on_alloc(&s_global_stats, instance_size));
+
+	return class_create_in_place(type, memory);
+}
+
+// memory must be at least class_type_get_instance_size(type) bytes
+Class* class_create_in_place(const ClassType* type, void* memory)
+{
+	if (type == NULL || memory == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return NULL;
+	}
+
+	Class* klass = (Class*)memory;
+	klass->type = type;
+
+	if (type->payload_size > 0) {
+		memcpy(class_payload(klass), type->default_payload, type->payload_size);
+	}
+
+	// whatever the constructors wrote is the initial state, not a change
+	class_type_construct(type, klass);
+	klass->dirty = 0;
+	klass->cached = 0;
+	CLASS_STAT(const size_t ctor_calls = class_type_count_ctors(type));
+
+	CLASS_STAT(class_stats_on_construct(&((ClassType*)type)->stats, ctor_calls));
+	CLASS_STAT(class_stats_on_construct(&s_global_stats, ctor_calls));
+
+	return klass;
+}
+
+void class_destroy(Class* klass)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	class_destroy_with_allocator(klass, class_type_get_allocator(klass->type));
+}
+
+void class_destroy_with_allocator(Class* klass, const Allocator* allocator)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	CLASS_STAT(const size_t instance_size = class_type_get_instance_size(klass->type));
+	CLASS_STAT(class_stats_on_free(&((ClassType*)klass->type)->stats, instance_size));
+	CLASS_STAT(class_stats_on_free(&s_global_stats, instance_size));
+
+	class_destroy_in_place(klass);
+	allocator_free(allocator, klass);
+}
+
+// runs the destructor without releasing the instance memory
+void class_destroy_in_place(Class* klass)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	CLASS_STAT(const size_t dtor_calls = class_type_count_dtors(klass->type));
+	class_type_destruct(klass->type, klass);
+
+	CLASS_STAT(class_stats_on_destruct(&((ClassType*)klass->type)->stats, dtor_calls));
+	CLASS_STAT(class_stats_on_destruct(&s_global_stats, dtor_calls));
+}
+
+// copies the payload into a new instance of the same type. constructors are not run,
+// the copy functions of the type and its bases run instead, base first
+Class* class_clone(const Class* klass)
+{
+	if (klass == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return NULL;
+	}
+
+	return class_clone_with_allocator(klass, class_type_get_allocator(klass->type));
+}
+
+Class* class_clone_with_allocator(const Class* klass, const Allocator* allocator)
+{
+	if (klass == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return NULL;
+	}
+
+	const size_t instance_size = class_type_get_instance_size(klass->type);
+	void* memory = allocator_alloc_aligned(allocator, instance_size, class_type_get_instance_alignment(klass->type));
+	if (memory == NULL) {
+		return NULL;
+	}
+
+	CLASS_STAT(class_stats_on_alloc(&((ClassType*)klass->type)->stats, instance_size));
+	CLASS_STAT(class_stats_on_alloc(&s_global_stats, instance_size));
+
+	return class_clone_in_place(klass, memory);
+}
+
+// memory must be at least class_type_get_instance_size bytes of the source's type
+Class* class_clone_in_place(const Class* klass, void* memory)
+{
+	if (klass == NULL || memory == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return NULL;
+	}
+
+	Class* clone = (Class*)memory;
+	clone->type = klass->type;
+	clone->dirty = 0;
+	clone->cached = klass->cached;
+	memcpy(class_payload(clone), class_payload(klass), class_type_get_payload_size(klass->type));
+	class_type_copy(klass->type, clone, klass);
+
+	CLASS_STAT(const size_t copy_calls = class_type_count_copies(klass->type));
+	CLASS_STAT(class_stats_on_copy(&((ClassType*)klass->type)->stats, copy_calls));
+	CLASS_STAT(class_stats_on_copy(&s_global_stats, copy_calls));
+
+	return clone;
+}
+
+const ClassType* class_get_type(const Class* klass)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	return klass->type;
+}
+
+const char* class_get_name(const Class* klass)
+{
+	if (klass == NULL) {
+		return NULL;
+	}
+
+	return class_type_get_name(klass->type);
+}
+
+int class_has_constructor(const Class* klass)
+{
+	if (klass == NULL) {
+		return 0;
+	}
+
+	return klass->type->ctor.fn != NULL;
+}
+
+int class_has_destructor(const Class* klass)
+{
+	if (klass == NULL) {
+		return 0;
+	}
+
+	return klass->type->dtor.fn != NULL;
+}
+
+const Function* class_get_constructor(const Class* klass)
+{
+	if (class_has_constructor(klass) == 0) {
+		return NULL;
+	}
+
+	return &klass->type->ctor;
+}
+
+const Function* class_get_destructor(const Class* klass)
+{
+	if (class_has_destructor(klass) == 0) {
+		return NULL;
+	}
+
+	return &klass->type->dtor;
+}
+
+Class* class_invoke_function(const Class* klass, const Class* other, size_t index)
+{
+	if (klass == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return NULL;
+	}
+
+	const size_t num_functions = class_get_num_functions(klass);
+	if (index >= num_functions) {
+		DEBUG_BREAK("index out of bounds!");
+		return NULL;
+	}
+
+	const Function* function = class_get_function(klass, index);
+	return function_invoke(function, klass, other);
+}
+
+// out must be an instance of the function's result type, e.g. preallocated or created in place on the stack
+void class_invoke_function_into(Class* out, const Class* klass, const Class* other, size_t index)
+{
+	if (out == NULL || klass == NULL || other == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return;
+	}
+
+	const size_t num_functions = class_get_num_functions(klass);
+	if (index >= num_functions) {
+		DEBUG_BREAK("index out of bounds!");
+		return;
+	}
+
+	const Function* function = class_get_function(klass, index);
+	if (function->binary_member_into_fn != NULL) {
+		function_invoke_into(function, out, klass, other);
+		return;
+	}
+
+	// functions without an in-place form still go through a temporary
+	Class* result = function_invoke(function, klass, other);
+	if (result == NULL) {
+		return;
+	}
+
+	if (class_get_type(result) != class_get_type(out)) {
+		DEBUG_BREAK("result type mismatch!");
+	} else {
+		memcpy(class_payload(out), class_payload(result), class_type_get_payload_size(out->type));
+		class_payload_written(out);
+	}
+
+	class_destroy(result);
+}
+
+const Member* class_get_member(const Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", NULL);
+	return class_get_member_unchecked(klass, index);
+}
+
+MemberData class_get_member_data(const Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, (MemberData){ 0 });
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", (MemberData){ 0 });
+	return class_get_member_data_unchecked(klass, index);
+}
+
+void class_set_member_data(Class* klass, size_t index, MemberData data)
+{
+	CLASS_CHECK_NULL(klass, );
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", );
+	class_set_member_data_unchecked(klass, index, data);
+}
+
+static void class_set_member_value(Class* klass, size_t index, MemberType type, const void* value, size_t size)
+{
+	CLASS_CHECK_NULL(klass, );
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", );
+	CLASS_CHECK(klass->type->members[index].type == type, "member type mismatch!", );
+	memcpy(class_get_member_address_unchecked(klass, index), value, size);
+	class_member_written(klass, index);
+}
+
+void class_set_member_f32(Class* klass, size_t index, float value)
+{
+	class_set_member_value(klass, index, MEMBER_TYPE_F32, &value, sizeof(value));
+}
+
+void class_set_member_f64(Class* klass, size_t index, double value)
+{
+	class_set_member_value(klass, index, MEMBER_TYPE_F64, &value, sizeof(value));
+}
+
+void class_set_member_i32(Class* klass, size_t index, int32_t value)
+{
+	class_set_member_value(klass, index, MEMBER_TYPE_I32, &value, sizeof(value));
+}
+
+void class_set_member_u32(Class* klass, size_t index, uint32_t value)
+{
+	class_set_member_value(klass, index, MEMBER_TYPE_U32, &value, sizeof(value));
+}
+
+// writes through class_get_member_address, the payload or an into function are not tracked, mark them here
+void class_mark_member_dirty(Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, );
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", );
+	class_member_written(klass, index);
+}
+
+int class_is_member_dirty(const Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, 0);
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", 0);
+	return (klass->dirty & class_member_dirty_bit(index)) != 0;
+}
+
+uint64_t class_get_dirty_mask(const Class* klass)
+{
+	CLASS_CHECK_NULL(klass, 0);
+	return klass->dirty;
+}
+
+// called by the consumer once it has synced or serialized the changes
+void class_clear_dirty(Class* klass)
+{
+	CLASS_CHECK_NULL(klass, );
+	klass->dirty = 0;
+}
+
+// evaluates the computed member on the first read after a dependency changed and caches it in the instance.
+// filling the cache writes to the instance, so first reads of one instance must not race each other
+const void* class_get_computed(const Class* klass, size_t slot)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	CLASS_CHECK(slot < klass->type->num_computed, "index out of bounds!", NULL);
+
+	const ComputedMember* computed = &klass->type->computed[slot];
+	unsigned char* value = class_payload(klass) + computed->offset;
+	const uint64_t bit = (uint64_t)1 << slot;
+	if ((klass->cached & bit) == 0) {
+		computed->fn(klass, value);
+		((Class*)klass)->cached |= bit;
+	}
+
+	return value;
+}
+
+MemberData class_get_computed_data(const Class* klass, size_t slot)
+{
+	const void* value = class_get_computed(klass, slot);
+	if (value == NULL || member_type_fits_data(klass->type->computed[slot].type) == 0) {
+		return (MemberData){ 0 };
+	}
+
+	return member_data_load(klass->type->computed[slot].type, value);
+}
+
+int class_is_computed_cached(const Class* klass, size_t slot)
+{
+	CLASS_CHECK_NULL(klass, 0);
+	CLASS_CHECK(slot < klass->type->num_computed, "index out of bounds!", 0);
+	return (klass->cached & ((uint64_t)1 << slot)) != 0;
+}
+
+// for writes the setters did not see, e.g. through the payload struct
+void class_invalidate_computed(Class* klass)
+{
+	CLASS_CHECK_NULL(klass, );
+	klass->cached = 0;
+}
+
+// vector members are aligned to member_get_alignment, wider ones are only reachable this way
+void* class_get_member_address(const Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	CLASS_CHECK(index < klass->type->num_members, "index out of bounds!", NULL);
+	return class_get_member_address_unchecked(klass, index);
+}
+
+// the payload can be viewed through a C struct with the same member order, see Vec2Data
+void* class_get_payload(const Class* klass)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	return (void*)class_payload(klass);
+}
+
+const Function* class_get_function(const Class* klass, size_t index)
+{
+	CLASS_CHECK_NULL(klass, NULL);
+	CLASS_CHECK(index < klass->type->num_functions, "index out of bounds!", NULL);
+	return &klass->type->functions[index];
+}
+
+const Member* class_find_member(const Class* klass, const char* name)
+{
+	if (klass == NULL) {
+		return NULL;
+	}
+
+	const size_t slot = class_type_find_member_slot(klass->type, name);
+	if (slot == CLASS_INVALID_SLOT) {
+		return NULL;
+	}
+
+	return class_get_member(klass, slot);
+}
+
+const Function* class_find_function(const Class* klass, const char* name)
+{
+	if (klass == NULL) {
+		return NULL;
+	}
+
+	const size_t slot = class_type_find_function_slot(klass->type, name);
+	if (slot == CLASS_INVALID_SLOT) {
+		return NULL;
+	}
+
+	return class_get_function(klass, slot);
+}
+
+size_t class_get_num_members(const Class* klass)
+{
+	CLASS_CHECK_NULL(klass, 0);
+	return class_get_num_members_unchecked(klass);
+}
+
+size_t class_get_num_functions(const Class* klass)
+{
+	CLASS_CHECK_NULL(klass, 0);
+	return klass->type->num_functions;
+}
+
+void class_writer_init(ClassWriter* writer, char* buffer, size_t capacity, ClassFormat format, ClassWriterSink sink, void* user_data)
+{
+	if (writer == NULL) {
+		DEBUG_BREAK("invalid writer!");
+		return;
+	}
+
+	writer->buffer = buffer;
+	writer->capacity = buffer != NULL ? capacity : 0;
+	writer->length = 0;
+	writer->sink = sink;
+	writer->user_data = user_data;
+	writer->format = format;
+	writer->overflowed = 0;
+}
+
+// hands the buffered output to the sink, a writer without a sink keeps it in the caller's buffer
+void class_writer_flush(ClassWriter* writer)
+{
+	if (writer == NULL || writer->sink == NULL) {
+		return;
+	}
+
+	if (writer->length > 0) {
+		writer->sink(writer->user_data, writer->buffer, writer->length);
+		writer->length = 0;
+	}
+}
+
+void class_writer_write(ClassWriter* writer, const char* data, size_t length)
+{
+	while (length > 0) {
+		size_t available = writer->capacity - writer->length;
+		if (available == 0) {
+			if (writer->sink == NULL) {
+				writer->overflowed = 1;
+				return;
+			}
+
+			class_writer_flush(writer);
+			available = writer->capacity;
+			if (available == 0) {
+				writer->sink(writer->user_data, data, length);
+				return;
+			}
+		}
+
+		const size_t chunk = length < available ? length : available;
+		memcpy(writer->buffer + writer->length, data, chunk);
+		writer->length += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+void class_writer_write_char(ClassWriter* writer, char c)
+{
+	if (writer->length < writer->capacity) {
+		writer->buffer[writer->length++] = c;
+		return;
+	}
+
+	class_writer_write(writer, &c, 1);
+}
+
+void class_writer_write_string(ClassWriter* writer, const char* string)
+{
+	if (string == NULL) {
+		string = "(null)";
+	}
+
+	class_writer_write(writer, string, strlen(string));
+}
+
+void class_writer_write_u64(ClassWriter* writer, uint64_t value)
+{
+	char digits[20];
+	size_t count = 0;
+	do {
+		digits[sizeof(digits) - 1 - count] = (char)('0' + value % 10);
+		value /= 10;
+		count++;
+	} while (value != 0);
+
+	class_writer_write(writer, digits + sizeof(digits) - count, count);
+}
+
+void class_writer_write_i64(ClassWriter* writer, int64_t value)
+{
+	if (value < 0) {
+		class_writer_write_char(writer, '-');
+		class_writer_write_u64(writer, (uint64_t)0 - (uint64_t)value);
+		return;
+	}
+
+	class_writer_write_u64(writer, (uint64_t)value);
+}
+
+// fixed notation with six decimals like printf's %f, values past the u64 range fall back to snprintf
+void class_writer_write_f64(ClassWriter* writer, double value)
+{
+	if (value != value) {
+		class_writer_write_string(writer, "nan");
+		return;
+	}
+
+	if (value < 0.0 || (value == 0.0 && 1.0 / value < 0.0)) {
+		class_writer_write_char(writer, '-');
+		value = -value;
+	}
+
+	if (value >= 1.8e19) {
+		char fallback[512];
+		const int length = snprintf(fallback, sizeof(fallback), "%f", value);
+		if (length > 0) {
+			class_writer_write(writer, fallback, (size_t)length);
+		}
+		return;
+	}
+
+	uint64_t integer = (uint64_t)value;
+	uint64_t fraction = (uint64_t)((value - (double)integer) * 1000000.0 + 0.5);
+	if (fraction >= 1000000) {
+		integer++;
+		fraction -= 1000000;
+	}
+
+	class_writer_write_u64(writer, integer);
+
+	char decimals[7];
+	decimals[0] = '.';
+	for (size_t i = 6; i > 0; i--) {
+		decimals[i] = (char)('0' + fraction % 10);
+		fraction /= 10;
+	}
+	class_writer_write(writer, decimals, sizeof(decimals));
+}
+
+void class_writer_write_member_data(ClassWriter* writer, MemberType type, MemberData data)
+{
+	switch (type) {
+		case MEMBER_TYPE_F32: class_writer_write_f64(writer, data.f_data); return;
+		case MEMBER_TYPE_F64: class_writer_write_f64(writer, data.d_data); return;
+		case MEMBER_TYPE_I32: class_writer_write_i64(writer, data.i_data); return;
+		case MEMBER_TYPE_U32: class_writer_write_u64(writer, data.u_data); return;
+		case MEMBER_TYPE_F32X2:
+			class_writer_write_f64(writer, data.v_data[0]);
+			class_writer_write_string(writer, ", ");
+			class_writer_write_f64(writer, data.v_data[1]);
+			return;
+		case MEMBER_TYPE_F32X4:
+		case MEMBER_TYPE_F32X8:
+		case MEMBER_TYPE_F32_ARRAY:
+			DEBUG_BREAK("member does not fit in member data!");
+			return;
+	}
+
+	DEBUG_BREAK("unknown member type!");
+}
+
+// sink for writing to a FILE*, pass the stream as user_data
+void class_writer_file_sink(void* user_data, const char* data, size_t length)
+{
+	fwrite(data, 1, length, (FILE*)user_data);
+}
+
+// escapes one character of a json string into out, which holds at least 6 bytes, returns the length.
+// shared by the writer and the trace export
+static size_t json_escape_char(char c, char* out)
+{
+	static const char hex[] = "0123456789abcdef";
+	if (c == '"' || c == '\\') {
+		out[0] = '\\';
+		out[1] = c;
+		return 2;
+	}
+
+	if ((unsigned char)c < 0x20) {
+		memcpy(out, "\\u00", 4);
+		out[4] = hex[(unsigned char)c >> 4];
+		out[5] = hex[(unsigned char)c & 0xf];
+		return 6;
+	}
+
+	out[0] = c;
+	return 1;
+}
+
+static void class_writer_write_json_string(ClassWriter* writer, const char* string)
+{
+	char escaped[6];
+	class_writer_write_char(writer, '"');
+	for (const char* c = string != NULL ? string : ""; *c != '\0'; c++) {
+		class_writer_write(writer, escaped, json_escape_char(*c, escaped));
+	}
+	class_writer_write_char(writer, '"');
+}
+
+// rfc 4180, a field holding a comma, a quote or a line break is quoted and its quotes are doubled
+static void class_writer_write_csv_field(ClassWriter* writer, const char* string)
+{
+	if (string == NULL) {
+		return;
+	}
+
+	if (strpbrk(string, ",\"\r\n") == NULL) {
+		class_writer_write(writer, string, strlen(string));
+		return;
+	}
+
+	class_writer_write_char(writer, '"');
+	for (const char* c = string; *c != '\0'; c++) {
+		if (*c == '"') {
+			class_writer_write_char(writer, '"');
+		}
+		class_writer_write_char(writer, *c);
+	}
+	class_writer_write_char(writer, '"');
+}
+
+// json has no representation for nan or infinities
+static void class_writer_write_json_f64(ClassWriter* writer, double value)
+{
+	if (value != value || value - value != 0.0) {
+		class_writer_write_string(writer, "null");
+	} else {
+		class_writer_write_f64(writer, value);
+	}
+}
+
+// vector and array members are written lane by lane from the payload, scalars go through MemberData
+static void class_write_member_value(ClassWriter* writer, const Class* klass, size_t index)
+{
+	const Member* member = class_get_member_unchecked(klass, index);
+	const MemberType member_type = member->type;
+	const int is_json = writer->format == CLASS_FORMAT_JSON;
+
+	if (member_type == MEMBER_TYPE_F32X2 || member_type == MEMBER_TYPE_F32X4 || member_type == MEMBER_TYPE_F32X8 || member_type == MEMBER_TYPE_F32_ARRAY) {
+		const char* separator = writer->format == CLASS_FORMAT_TEXT ? ", " : is_json ? "," : " ";
+		const unsigned char* lanes = (const unsigned char*)class_get_member_address_unchecked(klass, index);
+		const size_t num_lanes = member_get_size(member) / sizeof(float);
+
+		if (writer->format != CLASS_FORMAT_CSV) {
+			class_writer_write_char(writer, '[');
+		}
+		for (size_t i = 0; i < num_lanes; i++) {
+			float lane = 0.0f;
+			memcpy(&lane, lanes + sizeof(float) * i, sizeof(float));
+			if (i > 0) {
+				class_writer_write_string(writer, separator);
+			}
+			if (is_json) {
+				class_writer_write_json_f64(writer, lane);
+			} else {
+				class_writer_write_f64(writer, lane);
+			}
+		}
+		if (writer->format != CLASS_FORMAT_CSV) {
+			class_writer_write_char(writer, ']');
+		}
+		return;
+	}
+
+	// scalars are read at their native width, only json formats floats differently
+	switch (member_type) {
+		case MEMBER_TYPE_F32:
+		case MEMBER_TYPE_F64: {
+			const double value = member_type == MEMBER_TYPE_F32 ? class_get_f32(klass, index) : class_get_f64(klass, index);
+			if (is_json) {
+				class_writer_write_json_f64(writer, value);
+			} else {
+				class_writer_write_f64(writer, value);
+			}
+			return;
+		}
+		case MEMBER_TYPE_I32: class_writer_write_i64(writer, class_get_i32(klass, index)); return;
+		case MEMBER_TYPE_U32: class_writer_write_u64(writer, class_get_u32(klass, index)); return;
+		case MEMBER_TYPE_F32X2:
+		case MEMBER_TYPE_F32X4:
+		case MEMBER_TYPE_F32X8:
+		case MEMBER_TYPE_F32_ARRAY:
+			break;
+	}
+
+	DEBUG_BREAK("unknown member type!");
+}
+
+static void class_write_text(ClassWriter* writer, const Class* klass)
+{
+	const size_t num_members = class_get_num_members_unchecked(klass);
+	const size_t num_functions = class_get_num_functions(klass);
+
+	class_writer_write_string(writer, "Class: ");
+	class_writer_write_string(writer, class_get_name(klass));
+	class_writer_write_string(writer, "\nData Members: ");
+	class_writer_write_u64(writer, num_members);
+	class_writer_write_string(writer, "\nMember Functions: ");
+	class_writer_write_u64(writer, num_functions);
+
+	const Function* ctor = class_get_constructor(klass);
+	class_writer_write_string(writer, "\nCtor: ");
+	class_writer_write_string(writer, ctor != NULL ? function_get_name(ctor) : NULL);
+
+	const Function* dtor = class_get_destructor(klass);
+	class_writer_write_string(writer, "\nDtor: ");
+	class_writer_write_string(writer, dtor != NULL ? function_get_name(dtor) : NULL);
+
+	class_writer_write_string(writer, "\n\nData Members: ");
+	if (num_members == 0) {
+		class_writer_write_string(writer, "(null)");
+	}
+	class_writer_write_char(writer, '\n');
+
+	for (size_t i = 0; i < num_members; i++) {
+		const Member* member = class_get_member_unchecked(klass, i);
+		const MemberType member_type = member->type;
+		class_writer_write_u64(writer, i + 1);
+		class_writer_write_string(writer, ".\tName: ");
+		class_writer_write_string(writer, member->name);
+		class_writer_write_string(writer, "\n\tType: ");
+		class_writer_write_string(writer, member_type_to_string(member_type));
+		class_writer_write_string(writer, "\n\tData: ");
+		class_write_member_value(writer, klass, i);
+		class_writer_write_char(writer, '\n');
+	}
+
+	class_writer_write_string(writer, "\nMember Functions: ");
+	if (num_functions == 0) {
+		class_writer_write_string(writer, "(null)");
+	}
+	class_writer_write_char(writer, '\n');
+
+	for (size_t i = 0; i < num_functions; i++) {
+		const Function* function = class_get_function(klass, i);
+		class_writer_write_u64(writer, i + 1);
+		class_writer_write_string(writer, ".\tName: ");
+		class_writer_write_string(writer, function_get_name(function));
+		class_writer_write_char(writer, '\n');
+	}
+}
+
+static void class_write_json(ClassWriter* writer, const Class* klass)
+{
+	class_writer_write_string(writer, "{\"class\":");
+	class_writer_write_json_string(writer, class_get_name(klass));
+
+	const size_t num_members = class_get_num_members_unchecked(klass);
+	for (size_t i = 0; i < num_members; i++) {
+		class_writer_write_char(writer, ',');
+		class_writer_write_json_string(writer, class_get_member_unchecked(klass, i)->name);
+		class_writer_write_char(writer, ':');
+		class_write_member_value(writer, klass, i);
+	}
+
+	class_writer_write_char(writer, '}');
+}
+
+static void class_write_csv_header(ClassWriter* writer, const Class* klass)
+{
+	const size_t num_members = class_get_num_members_unchecked(klass);
+	for (size_t i = 0; i < num_members; i++) {
+		if (i > 0) {
+			class_writer_write_char(writer, ',');
+		}
+		class_writer_write_csv_field(writer, class_get_member_unchecked(klass, i)->name);
+	}
+	class_writer_write_char(writer, '\n');
+}
+
+static void class_write_csv(ClassWriter* writer, const Class* klass)
+{
+	const size_t num_members = class_get_num_members_unchecked(klass);
+	for (size_t i = 0; i < num_members; i++) {
+		if (i > 0) {
+			class_writer_write_char(writer, ',');
+		}
+		class_write_member_value(writer, klass, i);
+	}
+	class_writer_write_char(writer, '\n');
+}
+
+// writes one instance in the writer's format without flushing
+void class_write(ClassWriter* writer, const Class* klass)
+{
+	if (writer == NULL || klass == NULL) {
+		return;
+	}
+
+	switch (writer->format) {
+		case CLASS_FORMAT_TEXT: class_write_text(writer, klass); return;
+		case CLASS_FORMAT_JSON: class_write_json(writer, klass); return;
+		case CLASS_FORMAT_CSV: class_write_csv(writer, klass); return;
+	}
+
+	DEBUG_BREAK("unknown format!");
+}
+
+// json batches are written as one array, csv batches get a single header row from the first instance
+void class_write_batch(ClassWriter* writer, const Class* const* instances, size_t count)
+{
+	if (writer == NULL || (instances == NULL && count > 0)) {
+		return;
+	}
+
+	if (writer->format == CLASS_FORMAT_JSON) {
+		class_writer_write_char(writer, '[');
+	} else if (writer->format == CLASS_FORMAT_CSV && count > 0 && instances[0] != NULL) {
+		class_write_csv_header(writer, instances[0]);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (writer->format == CLASS_FORMAT_JSON && i > 0) {
+			class_writer_write_char(writer, ',');
+		} else if (writer->format == CLASS_FORMAT_TEXT && i > 0) {
+			class_writer_write_char(writer, '\n');
+		}
+		class_write(writer, instances[i]);
+	}
+
+	if (writer->format == CLASS_FORMAT_JSON) {
+		class_writer_write_string(writer, "]\n");
+	}
+
+	class_writer_flush(writer);
+}
+
+void class_debug_print(const Class* klass)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	char buffer[1024];
+	ClassWriter writer;
+	class_writer_init(&writer, buffer, sizeof(buffer), CLASS_FORMAT_TEXT, class_writer_file_sink, stdout);
+	class_write(&writer, klass);
+	class_writer_flush(&writer);
+}
+
+static Class* class_cow_block_instance(const ClassCowBlock* block)
+{
+	return (Class*)((unsigned char*)block + block->instance_offset);
+}
+
+// the shared copies always live in malloc'd blocks, independent of the type's allocator
+ClassCow class_cow_create(const Class* klass)
+{
+	ClassCow cow = { NULL };
+	if (klass == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return cow;
+	}
+
+	const size_t alignment = class_type_get_instance_alignment(class_get_type(klass));
+	const size_t instance_offset = ALIGN_UP(sizeof(ClassCowBlock), alignment);
+	ClassCowBlock* block = (ClassCowBlock*)ALIGNED_MALLOC(instance_offset + class_type_get_instance_size(class_get_type(klass)), alignment);
+	if (block == NULL) {
+		return cow;
+	}
+
+	atomic_init(&block->references, 1);
+	block->instance_offset = instance_offset;
+	class_clone_in_place(klass, class_cow_block_instance(block));
+
+	cow.block = block;
+	return cow;
+}
+
+// a clone is a reference count increment, the payload is not copied
+ClassCow class_cow_clone(ClassCow cow)
+{
+	if (cow.block != NULL) {
+		atomic_fetch_add_explicit(&cow.block->references, 1, memory_order_relaxed);
+	}
+
+	return cow;
+}
+
+const Class* class_cow_read(ClassCow cow)
+{
+	if (cow.block == NULL) {
+		return NULL;
+	}
+
+	return class_cow_block_instance(cow.block);
+}
+
+// detaches the handle from the other sharers first if needed, the returned instance is owned by this handle only
+Class* class_cow_write(ClassCow* cow)
+{
+	if (cow == NULL || cow->block == NULL) {
+		DEBUG_BREAK("invalid copy-on-write handle!");
+		return NULL;
+	}
+
+	if (atomic_load_explicit(&cow->block->references, memory_order_acquire) == 1) {
+		return class_cow_block_instance(cow->block);
+	}
+
+	ClassCow copy = class_cow_create(class_cow_block_instance(cow->block));
+	if (copy.block == NULL) {
+		return NULL;
+	}
+
+	class_cow_release(cow);
+	*cow = copy;
+	return class_cow_block_instance(cow->block);
+}
+
+void class_cow_release(ClassCow* cow)
+{
+	if (cow == NULL || cow->block == NULL) {
+		return;
+	}
+
+	if (atomic_fetch_sub_explicit(&cow->block->references, 1, memory_order_acq_rel) == 1) {
+		class_destroy_in_place(class_cow_block_instance(cow->block));
+		ALIGNED_FREE(cow->block);
+	}
+
+	cow->block = NULL;
+}
+
+int class_cow_is_shared(ClassCow cow)
+{
+	if (cow.block == NULL) {
+		return 0;
+	}
+
+	return atomic_load_explicit(&cow.block->references, memory_order_acquire) > 1;
+}
+
+static int archive_write_u32(FILE* file, uint32_t value)
+{
+	return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static int archive_write_string(FILE* file, const char* string)
+{
+	const uint32_t length = (uint32_t)class_name_length(string);
+	if (archive_write_u32(file, length) == 0) {
+		return 0;
+	}
+
+	return length == 0 || fwrite(string, 1, length, file) == length;
+}
+
+static int archive_write_zeros(FILE* file, size_t size)
+{
+	static const unsigned char zeros[64] = { 0 };
+	while (size > 0) {
+		const size_t chunk = size < sizeof(zeros) ? size : sizeof(zeros);
+		if (fwrite(zeros, 1, chunk, file) != chunk) {
+			return 0;
+		}
+		size -= chunk;
+	}
+
+	return 1;
+}
+
+// the header up to the padding before the first record
+static size_t archive_get_header_size(const ClassType* type)
+{
+	size_t size = sizeof(uint32_t) * 3 + sizeof(uint64_t) + sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(uint32_t) * 4;
+	size += sizeof(uint32_t) + class_name_length(class_type_get_name(type));
+	for (size_t i = 0; i < type->num_members; i++) {
+		size += sizeof(uint32_t) * 4 + class_name_length(type->members[i].name);
+	}
+
+	return size;
+}
+
+// writes the schema of the type followed by every instance at instance stride, with the
+// instance header zeroed, so a mapping of the file can be used in place
+int class_archive_write(FILE* file, const ClassType* type, const Class* const* instances, size_t count)
+{
+	if (file == NULL || type == NULL || (instances == NULL && count > 0)) {
+		DEBUG_BREAK("invalid archive!");
+		return 0;
+	}
+
+	const size_t payload_size = class_type_get_payload_size(type);
+	const size_t num_members = class_type_get_num_members(type);
+	const size_t stride = class_type_get_instance_size(type);
+	const size_t alignment = class_type_get_instance_alignment(type);
+	const size_t header_size = archive_get_header_size(type);
+	const size_t records_offset = ALIGN_UP(header_size, alignment);
+	const uint64_t instance_count = count;
+
+	int ok = archive_write_u32(file, CLASS_ARCHIVE_MAGIC);
+	ok = ok && archive_write_u32(file, CLASS_ARCHIVE_VERSION);
+	ok = ok && archive_write_u32(file, type->schema_version);
+	ok = ok && fwrite(&type->schema_hash, sizeof(type->schema_hash), 1, file) == 1;
+	ok = ok && archive_write_u32(file, (uint32_t)payload_size);
+	ok = ok && archive_write_u32(file, (uint32_t)num_members);
+	ok = ok && fwrite(&instance_count, sizeof(instance_count), 1, file) == 1;
+	ok = ok && archive_write_u32(file, (uint32_t)stride);
+	ok = ok && archive_write_u32(file, (uint32_t)type->payload_offset);
+	ok = ok && archive_write_u32(file, (uint32_t)alignment);
+	ok = ok && archive_write_u32(file, (uint32_t)records_offset);
+	ok = ok && archive_write_string(file, class_type_get_name(type));
+
+	for (size_t i = 0; ok && i < num_members; i++) {
+		const Member* member = class_type_get_member(type, i);
+		ok = ok && archive_write_u32(file, (uint32_t)member_get_type(member));
+		ok = ok && archive_write_u32(file, member->offset);
+		ok = ok && archive_write_u32(file, member->count);
+		ok = ok && archive_write_string(file, member_get_name(member));
+	}
+	ok = ok && archive_write_zeros(file, records_offset - header_size);
+
+	for (size_t i = 0; ok && i < count; i++) {
+		if (class_get_type(instances[i]) != type) {
+			DEBUG_BREAK("instance type does not match the archive!");
+			return 0;
+		}
+		ok = archive_write_zeros(file, type->payload_offset);
+		ok = ok && (payload_size == 0 || fwrite(class_get_payload(instances[i]), payload_size, 1, file) == 1);
+		ok = ok && archive_write_zeros(file, stride - type->payload_offset - payload_size);
+	}
+
+	return ok;
+}
+
+// archives are read from a FILE or straight from memory, e.g. a mapped file. offset counts
+// the bytes consumed in both cases, mapping is set when the records may be patched and used in place
+typedef struct ArchiveSource {
+	FILE* file;
+	const unsigned char* data;
+	size_t size;
+	size_t offset;
+	unsigned char* mapping;
+} ArchiveSource;
+
+// one member of the stored schema, the name is resolved to an atom of the running process
+typedef struct ArchiveMember {
+	MemberType type;
+	uint32_t offset;
+	uint32_t count;
+	NameAtom atom;
+} ArchiveMember;
+
+// copies lanes lanes of a stored member into a member of the type, converting the lane type on the way
+typedef struct ArchiveMigrationStep {
+	MemberType source_lane_type;
+	MemberType destination_lane_type;
+	uint32_t source_offset;
+	uint32_t destination_offset;
+	uint32_t lanes;
+} ArchiveMigrationStep;
+
+static int archive_source_read(ArchiveSource* source, void* out, size_t size)
+{
+	if (size == 0) {
+		return 1;
+	}
+
+	if (source->file != NULL) {
+		if (fread(out, size, 1, source->file) != 1) {
+			return 0;
+		}
+		source->offset += size;
+		return 1;
+	}
+
+	if (source->size - source->offset < size) {
+		return 0;
+	}
+
+	memcpy(out, source->data + source->offset, size);
+	source->offset += size;
+	return 1;
+}
+
+static int archive_source_skip(ArchiveSource* source, size_t size)
+{
+	if (source->file != NULL) {
+		for (size_t i = 0; i < size; i++) {
+			if (fgetc(source->file) == EOF) {
+				return 0;
+			}
+		}
+		source->offset += size;
+		return 1;
+	}
+
+	if (source->size - source->offset < size) {
+		return 0;
+	}
+
+	source->offset += size;
+	return 1;
+}
+
+static int archive_source_read_u32(ArchiveSource* source, uint32_t* value)
+{
+	return archive_source_read(source, value, sizeof(*value));
+}
+
+// reads a stored name, hashes it into the schema hash and looks it up without interning it
+static int archive_source_read_name(ArchiveSource* source, NameAtom* atom, uint32_t type, uint32_t offset, uint32_t count, uint64_t* hash)
+{
+	uint32_t length = 0;
+	if (archive_source_read_u32(source, &length) == 0) {
+		return 0;
+	}
+
+	char* name = (char*)malloc((size_t)length + 1);
+	if (name == NULL) {
+		return 0;
+	}
+
+	if (archive_source_read(source, name, length) == 0) {
+		free(name);
+		return 0;
+	}
+	name[length] = '\0';
+
+	*atom = name_lookup(name);
+	if (hash != NULL) {
+		*hash = class_schema_hash_member(*hash, type, offset, count, name, length);
+	}
+
+	free(name);
+	return 1;
+}
+
+static size_t archive_member_get_lanes(MemberType type, uint32_t count)
+{
+	const size_t size = type == MEMBER_TYPE_F32_ARRAY ? member_type_get_size(type) * count : member_type_get_size(type);
+	return size / member_type_get_size(member_type_get_lane_type(type));
+}
+
+static double archive_load_lane(MemberType lane_type, const unsigned char* source)
+{
+	switch (lane_type) {
+		case MEMBER_TYPE_F32: { float value; memcpy(&value, source, sizeof(value)); return value; }
+		case MEMBER_TYPE_F64: { double value; memcpy(&value, source, sizeof(value)); return value; }
+		case MEMBER_TYPE_I32: { int32_t value; memcpy(&value, source, sizeof(value)); return value; }
+		case MEMBER_TYPE_U32: { uint32_t value; memcpy(&value, source, sizeof(value)); return value; }
+		default: break;
+	}
+
+	return 0.0;
+}
+
+// out of range values clamp to the nearest representable one and NaN becomes 0,
+// a plain cast of either is undefined. archive migration and the integer scale operators share these
+static int32_t class_saturate_i32(double value)
+{
+	if (value != value) {
+		return 0;
+	}
+
+	if (value <= (double)INT32_MIN) {
+		return INT32_MIN;
+	}
+
+	if (value >= (double)INT32_MAX) {
+		return INT32_MAX;
+	}
+
+	return (int32_t)value;
+}
+
+static uint32_t class_saturate_u32(double value)
+{
+	if (value != value || value <= 0.0) {
+		return 0;
+	}
+
+	if (value >= (double)UINT32_MAX) {
+		return UINT32_MAX;
+	}
+
+	return (uint32_t)value;
+}
+
+static void archive_store_lane(MemberType lane_type, unsigned char* destination, double value)
+{
+	switch (lane_type) {
+		case MEMBER_TYPE_F32: { const float lane = (float)value; memcpy(destination, &lane, sizeof(lane)); return; }
+		case MEMBER_TYPE_F64: memcpy(destination, &value, sizeof(value)); return;
+		case MEMBER_TYPE_I32: { const int32_t lane = class_saturate_i32(value); memcpy(destination, &lane, sizeof(lane)); return; }
+		case MEMBER_TYPE_U32: { const uint32_t lane = class_saturate_u32(value); memcpy(destination, &lane, sizeof(lane)); return; }
+		default: break;
+	}
+}
+
+// matches every member of the type to the stored member with the same name, returns the number of steps
+static size_t archive_build_migration(const ClassType* type, const ArchiveMember* stored, size_t num_stored, ArchiveMigrationStep* steps)
+{
+	size_t num_steps = 0;
+	for (size_t i = 0; i < type->num_members; i++) {
+		const Member* member = &type->members[i];
+		for (size_t j = 0; j < num_stored; j++) {
+			if (stored[j].atom == NAME_ATOM_NONE || stored[j].atom != member->atom) {
+				continue;
+			}
+
+			// widened vectors and arrays keep their defaults in the lanes the archive does not have
+			const size_t stored_lanes = archive_member_get_lanes(stored[j].type, stored[j].count);
+			const size_t lanes = archive_member_get_lanes(member->type, member->count);
+			ArchiveMigrationStep* step = &steps[num_steps++];
+			step->source_lane_type = member_type_get_lane_type(stored[j].type);
+			step->destination_lane_type = member_type_get_lane_type(member->type);
+			step->source_offset = stored[j].offset;
+			step->destination_offset = member->offset;
+			step->lanes = (uint32_t)(stored_lanes < lanes ? stored_lanes : lanes);
+			break;
+		}
+	}
+
+	return num_steps;
+}
+
+// runs one step over every record before moving on to the next member,
+// each pass is a single strided loop with the lane conversion chosen once.
+// payloads and source point at the first payload, the strides are the distances between records
+static void archive_migrate_column(const ArchiveMigrationStep* step, unsigned char* payloads, size_t stride, const unsigned char* source, size_t source_stride, size_t count)
+{
+	unsigned char* destination = payloads + step->destination_offset;
+	const unsigned char* origin = source + step->source_offset;
+
+	if (step->source_lane_type == step->destination_lane_type) {
+		const size_t size = member_type_get_size(step->source_lane_type) * step->lanes;
+		for (size_t i = 0; i < count; i++) {
+			memcpy(destination + stride * i, origin + source_stride * i, size);
+		}
+		return;
+	}
+
+	const size_t source_lane_size = member_type_get_size(step->source_lane_type);
+	const size_t destination_lane_size = member_type_get_size(step->destination_lane_type);
+	for (size_t i = 0; i < count; i++) {
+		for (size_t lane = 0; lane < step->lanes; lane++) {
+			const double value = archive_load_lane(step->source_lane_type, origin + source_stride * i + source_lane_size * lane);
+			archive_store_lane(step->destination_lane_type, destination + stride * i + destination_lane_size * lane, value);
+		}
+	}
+}
+
+static ClassArchive* archive_read_source(ArchiveSource* source, const ClassType* type)
+{
+	uint32_t magic = 0, version = 0, schema_version = 0, payload_size = 0, num_members = 0;
+	uint32_t stride = 0, payload_offset = 0, alignment = 0, records_offset = 0;
+	uint64_t schema_hash = 0, count = 0;
+	int ok = archive_source_read_u32(source, &magic) && magic == CLASS_ARCHIVE_MAGIC;
+	ok = ok && archive_source_read_u32(source, &version) && version >= 2 && version <= CLASS_ARCHIVE_VERSION;
+	if (ok && version >= 3) {
+		ok = archive_source_read_u32(source, &schema_version);
+		ok = ok && archive_source_read(source, &schema_hash, sizeof(schema_hash));
+	}
+	ok = ok && archive_source_read_u32(source, &payload_size);
+	ok = ok && archive_source_read_u32(source, &num_members);
+	ok = ok && archive_source_read(source, &count, sizeof(count));
+
+	// before version 4 the payloads are stored packed, without instance headers
+	if (ok && version >= 4) {
+		ok = archive_source_read_u32(source, &stride);
+		ok = ok && archive_source_read_u32(source, &payload_offset);
+		ok = ok && archive_source_read_u32(source, &alignment);
+		ok = ok && archive_source_read_u32(source, &records_offset);
+		ok = ok && alignment != 0 && records_offset % alignment == 0;
+		ok = ok && (size_t)payload_offset + payload_size <= stride;
+	} else {
+		stride = payload_size;
+	}
+
+	NameAtom type_atom = NAME_ATOM_NONE;
+	ok = ok && archive_source_read_name(source, &type_atom, 0, 0, 0, NULL) && type_atom == type->atom;
+	if (ok == 0) {
+		return NULL;
+	}
+
+	ArchiveMember* stored = num_members > 0 ? (ArchiveMember*)malloc(sizeof(ArchiveMember) * num_members) : NULL;
+	if (num_members > 0 && stored == NULL) {
+		return NULL;
+	}
+
+	// the stored layout is rehashed so version 2 archives are identified the same way
+	// only the members have to match, computed values and padding behind them are not stored
+	uint64_t stored_hash = CLASS_SCHEMA_HASH_SEED;
+	int matches = num_members == type->num_members;
+	for (uint32_t i = 0; ok && i < num_members; i++) {
+		uint32_t member_type = 0, offset = 0, element_count = 0;
+		ok = archive_source_read_u32(source, &member_type) && member_type <= MEMBER_TYPE_F32_ARRAY;
+		ok = ok && archive_source_read_u32(source, &offset);
+		ok = ok && archive_source_read_u32(source, &element_count);
+		ok = ok && archive_source_read_name(source, &stored[i].atom, member_type, offset, element_count, &stored_hash);
+		if (ok == 0) {
+			break;
+		}
+
+		stored[i].type = (MemberType)member_type;
+		stored[i].offset = offset;
+		stored[i].count = element_count;
+
+		const size_t size = member_type_get_size(stored[i].type) * (stored[i].type == MEMBER_TYPE_F32_ARRAY ? element_count : 1);
+		ok = (size_t)offset + size <= payload_size;
+
+		if (matches == 1 && i < type->num_members) {
+			const Member* member = &type->members[i];
+			matches = stored[i].atom == member->atom && stored[i].type == member->type && offset == member->offset && element_count == member->count;
+		}
+	}
+
+	// the records start at records_offset, the bytes before them only pad the header
+	if (ok && version >= 4) {
+		ok = records_offset >= source->offset && archive_source_skip(source, records_offset - source->offset);
+	}
+
+	const size_t instance_stride = class_type_get_instance_size(type);
+	const size_t largest_stride = instance_stride > stride ? instance_stride : stride;
+	ok = ok && count <= SIZE_MAX / largest_stride;
+
+	ClassArchive* archive = ok ? (ClassArchive*)malloc(sizeof(ClassArchive)) : NULL;
+	if (archive == NULL) {
+		free(stored);
+		return NULL;
+	}
+
+	archive->type = type;
+	archive->count = (size_t)count;
+	archive->stride = instance_stride;
+	archive->records = NULL;
+	archive->in_place = 0;
+	archive->schema_version = schema_version;
+	archive->schema_hash = version >= 3 ? schema_hash : stored_hash;
+	archive->migrated = matches == 0;
+
+	if (archive->count == 0) {
+		free(stored);
+		return archive;
+	}
+
+	// records of the current layout are the instances, they are used in place from a mapping or read with one fread
+	const size_t stored_size = (size_t)stride * archive->count;
+	const int direct = matches == 1 && version >= 4 && stride == instance_stride && payload_offset == type->payload_offset && payload_size == type->payload_size;
+	unsigned char* records = NULL;
+	if (source->file == NULL && source->size - source->offset < stored_size) {
+		ok = 0;
+	} else if (direct == 1 && source->mapping != NULL && ((uintptr_t)(source->mapping + source->offset) % class_type_get_instance_alignment(type)) == 0) {
+		archive->records = source->mapping + source->offset;
+		archive->in_place = 1;
+	} else {
+		archive->records = (unsigned char*)ALIGNED_MALLOC(instance_stride * archive->count, class_type_get_instance_alignment(type));
+		ok = archive->records != NULL;
+		if (ok && direct == 1) {
+			ok = archive_source_read(source, archive->records, stored_size);
+		} else if (ok && source->file == NULL) {
+			records = (unsigned char*)source->data + source->offset;
+		} else if (ok) {
+			records = (unsigned char*)malloc(stored_size);
+			ok = records != NULL && archive_source_read(source, records, stored_size);
+		}
+	}
+
+	ArchiveMigrationStep* steps = NULL;
+	if (ok && direct == 0 && matches == 0 && type->num_members > 0) {
+		steps = (ArchiveMigrationStep*)malloc(sizeof(ArchiveMigrationStep) * type->num_members);
+		ok = steps != NULL;
+	}
+
+	if (ok && direct == 0) {
+		const unsigned char* payloads = records + payload_offset;
+		unsigned char* destination = archive->records + type->payload_offset;
+		if (matches == 1) {
+			// the members are at the same offsets, whatever follows them starts from the defaults
+			const size_t copy_size = payload_size < type->payload_size ? payload_size : type->payload_size;
+			for (size_t i = 0; i < archive->count; i++) {
+				if (copy_size < type->payload_size) {
+					memcpy(destination + instance_stride * i, type->default_payload, type->payload_size);
+				}
+				memcpy(destination + instance_stride * i, payloads + (size_t)stride * i, copy_size);
+			}
+		} else {
+			// every record starts from the defaults, then the stored columns are converted one member at a time
+			for (size_t i = 0; i < archive->count && type->payload_size > 0; i++) {
+				memcpy(destination + instance_stride * i, type->default_payload, type->payload_size);
+			}
+
+			const size_t num_steps = archive_build_migration(type, stored, num_members, steps);
+			for (size_t i = 0; i < num_steps; i++) {
+				archive_migrate_column(&steps[i], destination, instance_stride, payloads, stride, archive->count);
+			}
+		}
+	}
+
+	free(steps);
+	if (source->file != NULL) {
+		free(records);
+	}
+	free(stored);
+
+	if (ok == 0) {
+		class_archive_destroy(archive);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < archive->count; i++) {
+		Class* klass = (Class*)(archive->records + instance_stride * i);
+		klass->type = type;
+		klass->dirty = 0;
+		klass->cached = 0;
+	}
+
+	return archive;
+}
+
+// an archive of the current layout is read with a single fread straight into the instances,
+// older layouts and archives of an older version are copied out record by record
+ClassArchive* class_archive_read(FILE* file, const ClassType* type)
+{
+	if (file == NULL || type == NULL) {
+		DEBUG_BREAK("invalid archive!");
+		return NULL;
+	}
+
+	ArchiveSource source = { file, NULL, 0, 0, NULL };
+	return archive_read_source(&source, type);
+}
+
+// data is a whole archive image. it is only read, the records are copied out of it
+ClassArchive* class_archive_read_memory(const void* data, size_t size, const ClassType* type)
+{
+	if (data == NULL || type == NULL) {
+		DEBUG_BREAK("invalid archive!");
+		return NULL;
+	}
+
+	ArchiveSource source = { NULL, (const unsigned char*)data, size, 0, NULL };
+	return archive_read_source(&source, type);
+}
+
+// data is a whole archive image the caller keeps alive, typically a writable private mapping of the file.
+// records of the current layout become the instances in place, only their headers are patched.
+// anything else falls back to the copying reader and data is left untouched
+ClassArchive* class_archive_map(void* data, size_t size, const ClassType* type)
+{
+	if (data == NULL || type == NULL) {
+		DEBUG_BREAK("invalid archive!");
+		return NULL;
+	}
+
+	ArchiveSource source = { NULL, (const unsigned char*)data, size, 0, (unsigned char*)data };
+	return archive_read_source(&source, type);
+}
+
+uint32_t class_archive_get_schema_version(const ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return 0;
+	}
+
+	return archive->schema_version;
+}
+
+// the hash of the layout the archive was written with
+uint64_t class_archive_get_schema_hash(const ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return 0;
+	}
+
+	return archive->schema_hash;
+}
+
+int class_archive_is_migrated(const ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return 0;
+	}
+
+	return archive->migrated;
+}
+
+int class_archive_is_in_place(const ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return 0;
+	}
+
+	return archive->in_place;
+}
+
+// archive instances are not constructed, so no destructors run here. in place records belong to the mapping
+void class_archive_destroy(ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return;
+	}
+
+	if (archive->in_place == 0) {
+		ALIGNED_FREE(archive->records);
+	}
+	free(archive);
+}
+
+size_t class_archive_get_count(const ClassArchive* archive)
+{
+	if (archive == NULL) {
+		return 0;
+	}
+
+	return archive->count;
+}
+
+Class* class_archive_get_instance(const ClassArchive* archive, size_t index)
+{
+	if (archive == NULL) {
+		return NULL;
+	}
+
+	if (index < archive->count) {
+		return (Class*)(archive->records + archive->stride * index);
+	}
+
+	DEBUG_BREAK("index out of bounds!");
+	return NULL;
+}
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// a registered type, the depot pool backs every thread's cache of free instance blocks
+typedef struct ClassRegistryEntry {
+	ClassType* type;
+	size_t id;
+	mtx_t depot_lock;
+	Pool* depot;
+} ClassRegistryEntry;
+
+typedef struct ThreadCacheBin {
+	void* free_list;
+	size_t count;
+} ThreadCacheBin;
+
+typedef struct ClassRegistry {
+	ClassRegistryEntry entries[CLASS_REGISTRY_CAPACITY];
+	atomic_size_t count;
+	mtx_t lock;
+} ClassRegistry;
+
+static ClassRegistry s_registry;
+static once_flag s_registry_once = ONCE_FLAG_INIT;
+static THREAD_LOCAL ThreadCacheBin s_thread_cache[CLASS_REGISTRY_CAPACITY];
+
+static void class_registry_init(void)
+{
+	atomic_init(&s_registry.count, 0);
+	mtx_init(&s_registry.lock, mtx_plain);
+}
+
+// moves up to count blocks from the depot into the bin, carving new chunks as needed
+static void class_registry_refill(ClassRegistryEntry* entry, ThreadCacheBin* bin, size_t count)
+{
+	mtx_lock(&entry->depot_lock);
+	for (size_t i = 0; i < count; i++) {
+		void* block = pool_alloc(entry->depot);
+		if (block == NULL) {
+			break;
+		}
+		*(void**)block = bin->free_list;
+		bin->free_list = block;
+		bin->count++;
+	}
+	mtx_unlock(&entry->depot_lock);
+}
+
+static void class_registry_drain(ClassRegistryEntry* entry, ThreadCacheBin* bin, size_t count)
+{
+	mtx_lock(&entry->depot_lock);
+	for (size_t i = 0; i < count && bin->free_list != NULL; i++) {
+		void* block = bin->free_list;
+		bin->free_list = *(void**)block;
+		bin->count--;
+		pool_free(entry->depot, block);
+	}
+	mtx_unlock(&entry->depot_lock);
+}
+
+// allocation only touches the calling thread's bin, the depot lock is taken once per refill.
+// the depot blocks are sized when the type is registered, members added to the type later make its instances too large
+static void* class_registry_alloc(void* user_data, size_t size, size_t alignment)
+{
+	ClassRegistryEntry* entry = (ClassRegistryEntry*)user_data;
+	if (size > entry->depot->block_size) {
+		DEBUG_BREAK("instance is larger than the registry blocks, the type changed after it was registered!");
+		return NULL;
+	}
+
+	if (alignment > entry->depot->alignment) {
+		DEBUG_BREAK("instance is more aligned than the registry blocks, the type changed after it was registered!");
+		return NULL;
+	}
+
+	ThreadCacheBin* bin = &s_thread_cache[entry->id];
+
+	if (bin->free_list == NULL) {
+		class_registry_refill(entry, bin, CLASS_THREAD_CACHE_SIZE / 2);
+		if (bin->free_list == NULL) {
+			return NULL;
+		}
+	}
+
+	void* block = bin->free_list;
+	bin->free_list = *(void**)block;
+	bin->count--;
+	return block;
+}
+
+// blocks freed on another thread than they were allocated on simply migrate to this thread's bin
+static void class_registry_free(void* user_data, void* memory)
+{
+	ClassRegistryEntry* entry = (ClassRegistryEntry*)user_data;
+	ThreadCacheBin* bin = &s_thread_cache[entry->id];
+
+	*(void**)memory = bin->free_list;
+	bin->free_list = memory;
+	bin->count++;
+
+	if (bin->count > CLASS_THREAD_CACHE_SIZE) {
+		class_registry_drain(entry, bin, CLASS_THREAD_CACHE_SIZE / 2);
+	}
+}
+
+// registers the type and makes the registry's thread-cached pools its default allocator.
+// register types at startup, before any instance of them exists and after every member and computed member was added
+int class_registry_register(ClassType* type)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return 0;
+	}
+
+	call_once(&s_registry_once, class_registry_init);
+
+	mtx_lock(&s_registry.lock);
+
+	const size_t count = atomic_load_explicit(&s_registry.count, memory_order_relaxed);
+	if (count == CLASS_REGISTRY_CAPACITY) {
+		mtx_unlock(&s_registry.lock);
+		DEBUG_BREAK("class registry is full!");
+		return 0;
+	}
+
+	ClassRegistryEntry* entry = &s_registry.entries[count];
+	entry->depot = pool_create_aligned(class_type_get_instance_size(type), CLASS_THREAD_CACHE_SIZE, class_type_get_instance_alignment(type));
+	if (entry->depot == NULL || mtx_init(&entry->depot_lock, mtx_plain) != thrd_success) {
+		pool_destroy(entry->depot);
+		mtx_unlock(&s_registry.lock);
+		return 0;
+	}
+
+	entry->type = type;
+	entry->id = count;
+
+	const Allocator allocator = { class_registry_alloc, class_registry_free, entry };
+	class_type_set_allocator(type, &allocator);
+
+	// publish the fully initialized entry, readers never take the lock
+	atomic_store_explicit(&s_registry.count, count + 1, memory_order_release);
+
+	mtx_unlock(&s_registry.lock);
+	return 1;
+}
+
+const ClassType* class_registry_find(const char* name)
+{
+	const NameAtom atom = name_lookup(name);
+	if (atom == NAME_ATOM_NONE) {
+		return NULL;
+	}
+
+	const size_t count = class_registry_get_count();
+	for (size_t i = 0; i < count; i++) {
+		const ClassType* type = s_registry.entries[i].type;
+		if (type->atom == atom) {
+			return type;
+		}
+	}
+
+	return NULL;
+}
+
+const ClassType* class_registry_get(size_t id)
+{
+	const size_t count = class_registry_get_count();
+	if (id < count) {
+		return s_registry.entries[id].type;
+	}
+
+	DEBUG_BREAK("index out of bounds!");
+	return NULL;
+}
+
+size_t class_registry_get_count(void)
+{
+	call_once(&s_registry_once, class_registry_init);
+	return atomic_load_explicit(&s_registry.count, memory_order_acquire);
+}
+
+// returns the calling thread's cached blocks to the depots, call before a worker thread exits
+void class_registry_flush_thread_cache(void)
+{
+	const size_t count = class_registry_get_count();
+	for (size_t i = 0; i < count; i++) {
+		ThreadCacheBin* bin = &s_thread_cache[i];
+		if (bin->count > 0) {
+			class_registry_drain(&s_registry.entries[i], bin, bin->count);
+		}
+	}
+}
+
+// releases every depot, all instances of registered types must be destroyed and all other threads flushed.
+// the types themselves stay owned by the caller and fall back to the default allocator
+void class_registry_shutdown(void)
+{
+	class_registry_flush_thread_cache();
+
+	mtx_lock(&s_registry.lock);
+
+	const size_t count = atomic_load_explicit(&s_registry.count, memory_order_relaxed);
+	for (size_t i = 0; i < count; i++) {
+		ClassRegistryEntry* entry = &s_registry.entries[i];
+		class_type_set_allocator(entry->type, NULL);
+		pool_destroy(entry->depot);
+		mtx_destroy(&entry->depot_lock);
+		entry->type = NULL;
+		entry->depot = NULL;
+	}
+
+	atomic_store_explicit(&s_registry.count, 0, memory_order_release);
+
+	mtx_unlock(&s_registry.lock);
+}
+
+ClassBatch* class_batch_create(const ClassType* type, size_t capacity)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return NULL;
+	}
+
+	ClassBatch* batch = (ClassBatch*)malloc(sizeof(ClassBatch));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->type = type;
+	batch->columns = NULL;
+	batch->count = 0;
+	batch->capacity = 0;
+	batch->dirty_masks = NULL;
+	batch->dirty_rows = NULL;
+	atomic_init(&batch->num_dirty, 0);
+
+	const size_t num_members = class_type_get_num_members(type);
+	if (num_members > 0) {
+		batch->columns = (void**)calloc(num_members, sizeof(void*));
+		if (batch->columns == NULL) {
+			free(batch);
+			return NULL;
+		}
+	}
+
+	if (class_batch_reserve(batch, capacity) == 0) {
+		class_batch_destroy(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+void class_batch_destroy(ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	const size_t num_members = class_type_get_num_members(batch->type);
+	if (batch->columns != NULL) {
+		for (size_t i = 0; i < num_members; i++) {
+			ALIGNED_FREE(batch->columns[i]);
+		}
+	}
+
+	free(batch->columns);
+	free(batch->dirty_masks);
+	free(batch->dirty_rows);
+	free(batch);
+}
+
+int class_batch_reserve(ClassBatch* batch, size_t capacity)
+{
+	if (batch == NULL) {
+		DEBUG_BREAK("invalid batch!");
+		return 0;
+	}
+
+	if (capacity <= batch->capacity) {
+		return 1;
+	}
+
+	// columns keep the member alignment so kernels can use aligned vector loads on them
+	const size_t num_members = class_type_get_num_members(batch->type);
+	for (size_t i = 0; i < num_members; i++) {
+		const Member* member = class_type_get_member(batch->type, i);
+		const size_t element_size = member_get_size(member);
+		void* column = ALIGNED_MALLOC(element_size * capacity, member_get_alignment(member));
+		if (column == NULL) {
+			return 0;
+		}
+		if (batch->columns[i] != NULL) {
+			memcpy(column, batch->columns[i], element_size * batch->count);
+			ALIGNED_FREE(batch->columns[i]);
+		}
+		batch->columns[i] = column;
+	}
+
+	uint64_t* dirty_masks = (uint64_t*)realloc(batch->dirty_masks, sizeof(uint64_t) * capacity);
+	if (dirty_masks == NULL) {
+		return 0;
+	}
+	batch->dirty_masks = dirty_masks;
+
+	size_t* dirty_rows = (size_t*)realloc(batch->dirty_rows, sizeof(size_t) * capacity);
+	if (dirty_rows == NULL) {
+		return 0;
+	}
+	batch->dirty_rows = dirty_rows;
+
+	batch->capacity = capacity;
+	return 1;
+}
+
+// a row enters the dirty list on its first change after a clear. the list slot is claimed atomically,
+// so parallel workers can mark the rows they own
+static void class_batch_mark_dirty(ClassBatch* batch, size_t row, uint64_t mask)
+{
+	if (mask == 0) {
+		return;
+	}
+
+	if (batch->dirty_masks[row] == 0) {
+		batch->dirty_rows[atomic_fetch_add_explicit(&batch->num_dirty, 1, memory_order_relaxed)] = row;
+	}
+
+	batch->dirty_masks[row] |= mask;
+}
+
+static void class_batch_row_copy_from(ClassBatchRow row, const Class* klass)
+{
+	const size_t num_members = class_get_num_members_unchecked(klass);
+	for (size_t i = 0; i < num_members; i++) {
+		memcpy(class_batch_row_get_member_address(row, i), class_get_member_address_unchecked(klass, i), member_get_size(class_get_member_unchecked(klass, i)));
+	}
+}
+
+// appends a row initialized with the member defaults of the type, constructors are not run on rows.
+// new rows start clean, like a newly created instance
+size_t class_batch_push(ClassBatch* batch)
+{
+	if (batch == NULL) {
+		DEBUG_BREAK("invalid batch!");
+		return CLASS_INVALID_SLOT;
+	}
+
+	if (batch->count == batch->capacity) {
+		const size_t capacity = batch->capacity > 0 ? batch->capacity * 2 : 16;
+		if (class_batch_reserve(batch, capacity) == 0) {
+			return CLASS_INVALID_SLOT;
+		}
+	}
+
+	const size_t row = batch->count++;
+	batch->dirty_masks[row] = 0;
+	const ClassBatchRow handle = class_batch_get_row(batch, row);
+	const size_t num_members = class_type_get_num_members(batch->type);
+	for (size_t i = 0; i < num_members; i++) {
+		const Member* member = class_type_get_member(batch->type, i);
+		memcpy(class_batch_row_get_member_address(handle, i), batch->type->default_payload + member->offset, member_get_size(member));
+	}
+
+	return row;
+}
+
+size_t class_batch_push_instance(ClassBatch* batch, const Class* klass)
+{
+	if (batch == NULL || klass == NULL || class_get_type(klass) != batch->type) {
+		DEBUG_BREAK("instance type does not match the batch!");
+		return CLASS_INVALID_SLOT;
+	}
+
+	const size_t row = class_batch_push(batch);
+	if (row == CLASS_INVALID_SLOT) {
+		return CLASS_INVALID_SLOT;
+	}
+
+	class_batch_row_copy_from(class_batch_get_row(batch, row), klass);
+	return row;
+}
+
+void class_batch_clear(ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	batch->count = 0;
+	atomic_store_explicit(&batch->num_dirty, 0, memory_order_relaxed);
+}
+
+const ClassType* class_batch_get_type(const ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	return batch->type;
+}
+
+size_t class_batch_get_count(const ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return 0;
+	}
+
+	return batch->count;
+}
+
+// the column holds class_batch_get_count elements of the member's native type, e.g. float* for f32
+void* class_batch_get_column(const ClassBatch* batch, size_t index)
+{
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	const size_t num_members = class_type_get_num_members(batch->type);
+	if (index < num_members) {
+		return batch->columns[index];
+	}
+
+	DEBUG_BREAK("index out of bounds!");
+	return NULL;
+}
+
+ClassBatchRow class_batch_get_row(ClassBatch* batch, size_t row)
+{
+	ClassBatchRow handle = { batch, row };
+	if (batch == NULL || row >= batch->count) {
+		DEBUG_BREAK("row out of bounds!");
+	}
+
+	return handle;
+}
+
+const Member* class_batch_row_get_member(ClassBatchRow row, size_t index)
+{
+	return class_type_get_member(class_batch_get_type(row.batch), index);
+}
+
+void* class_batch_row_get_member_address(ClassBatchRow row, size_t index)
+{
+	const Member* member = class_batch_row_get_member(row, index);
+	if (member == NULL) {
+		return NULL;
+	}
+
+	unsigned char* column = (unsigned char*)class_batch_get_column(row.batch, index);
+	return column + member_get_size(member) * row.row;
+}
+
+MemberData class_batch_row_get_member_data(ClassBatchRow row, size_t index)
+{
+	const Member* member = class_batch_row_get_member(row, index);
+	if (member == NULL) {
+		MemberData data = { 0 };
+		return data;
+	}
+
+	return member_data_load(member->type, class_batch_row_get_member_address(row, index));
+}
+
+void class_batch_row_set_member_data(ClassBatchRow row, size_t index, MemberData data)
+{
+	const Member* member = class_batch_row_get_member(row, index);
+	if (member == NULL) {
+		return;
+	}
+
+	member_data_store(member->type, class_batch_row_get_member_address(row, index), data);
+	class_batch_mark_dirty(row.batch, row.row, class_member_dirty_bit(index));
+}
+
+// for writes made straight into a column
+void class_batch_row_mark_dirty(ClassBatchRow row, size_t index)
+{
+	if (class_batch_row_get_member(row, index) == NULL) {
+		return;
+	}
+
+	class_batch_mark_dirty(row.batch, row.row, class_member_dirty_bit(index));
+}
+
+uint64_t class_batch_row_get_dirty_mask(ClassBatchRow row)
+{
+	if (row.batch == NULL || row.row >= row.batch->count) {
+		DEBUG_BREAK("row out of bounds!");
+		return 0;
+	}
+
+	return row.batch->dirty_masks[row.row];
+}
+
+size_t class_batch_get_num_dirty(const ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return 0;
+	}
+
+	return atomic_load_explicit(&batch->num_dirty, memory_order_relaxed);
+}
+
+// the dirty rows are listed in the order they were first changed
+size_t class_batch_get_dirty_row(const ClassBatch* batch, size_t index)
+{
+	if (batch == NULL || index >= atomic_load_explicit(&batch->num_dirty, memory_order_relaxed)) {
+		DEBUG_BREAK("index out of bounds!");
+		return CLASS_INVALID_SLOT;
+	}
+
+	return batch->dirty_rows[index];
+}
+
+// only touches the listed rows, so a sync pass costs the number of changes and not the batch size
+void class_batch_clear_dirty(ClassBatch* batch)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	const size_t num_dirty = atomic_load_explicit(&batch->num_dirty, memory_order_relaxed);
+	for (size_t i = 0; i < num_dirty; i++) {
+		batch->dirty_masks[batch->dirty_rows[i]] = 0;
+	}
+
+	atomic_store_explicit(&batch->num_dirty, 0, memory_order_relaxed);
+}
+
+// copies a row out into a standalone instance of the batch type
+void class_batch_row_load(ClassBatchRow row, Class* out)
+{
+	if (out == NULL || class_get_type(out) != class_batch_get_type(row.batch)) {
+		DEBUG_BREAK("instance type does not match the batch!");
+		return;
+	}
+
+	const size_t num_members = class_get_num_members_unchecked(out);
+	for (size_t i = 0; i < num_members; i++) {
+		memcpy(class_get_member_address_unchecked(out, i), class_batch_row_get_member_address(row, i), member_get_size(class_get_member_unchecked(out, i)));
+	}
+
+	out->cached = 0;
+}
+
+void class_batch_row_store(ClassBatchRow row, const Class* klass)
+{
+	if (klass == NULL || class_get_type(klass) != class_batch_get_type(row.batch)) {
+		DEBUG_BREAK("instance type does not match the batch!");
+		return;
+	}
+
+	class_batch_row_copy_from(row, klass);
+	class_batch_mark_dirty(row.batch, row.row, class_type_all_dirty_mask(klass->type));
+}
+
+static int class_batch_prepare_out(ClassBatch* out, size_t count)
+{
+	if (class_batch_reserve(out, count) == 0) {
+		return 0;
+	}
+
+	while (class_batch_get_count(out) < count) {
+		class_batch_push(out);
+	}
+
+	return 1;
+}
+
+// applies a binary member function to the first count rows of lhs and rhs, growing out to count rows
+void class_batch_invoke(const Function* function, ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count)
+{
+	if (function == NULL || out == NULL || lhs == NULL || rhs == NULL) {
+		DEBUG_BREAK("invalid batch!");
+		return;
+	}
+
+	if (count > class_batch_get_count(lhs) || count > class_batch_get_count(rhs)) {
+		DEBUG_BREAK("row out of bounds!");
+		return;
+	}
+
+	if (class_batch_prepare_out(out, count) == 0) {
+		return;
+	}
+
+	// column kernels run over the whole range in one call
+	if (function->batch_fn != NULL) {
+		if (CLASS_TRACING()) {
+			const uint64_t begin = class_trace_now();
+			function->batch_fn(out, lhs, rhs, count);
+			class_trace_record(CLASS_TRACE_BATCH, class_batch_get_type(lhs)->atom, function->atom, begin);
+		} else {
+			function->batch_fn(out, lhs, rhs, count);
+		}
+		const uint64_t mask = class_type_all_dirty_mask(class_batch_get_type(out));
+		for (size_t i = 0; i < count; i++) {
+			class_batch_mark_dirty(out, i, mask);
+		}
+		return;
+	}
+
+	// everything else goes row by row through scratch instances
+	Class* lhs_row = class_create(class_batch_get_type(lhs));
+	Class* rhs_row = class_create(class_batch_get_type(rhs));
+	Class* out_row = class_create(class_batch_get_type(out));
+	if (lhs_row != NULL && rhs_row != NULL && out_row != NULL) {
+		for (size_t i = 0; i < count; i++) {
+			class_batch_row_load(class_batch_get_row((ClassBatch*)lhs, i), lhs_row);
+			class_batch_row_load(class_batch_get_row((ClassBatch*)rhs, i), rhs_row);
+			if (function->binary_member_into_fn != NULL) {
+				function_invoke_into(function, out_row, lhs_row, rhs_row);
+			} else {
+				Class* result = function_invoke(function, lhs_row, rhs_row);
+				if (result == NULL) {
+					continue;
+				}
+				class_batch_row_store(class_batch_get_row(out, i), result);
+				class_destroy(result);
+				continue;
+			}
+			class_batch_row_store(class_batch_get_row(out, i), out_row);
+		}
+	}
+
+	if (lhs_row != NULL) {
+		class_destroy(lhs_row);
+	}
+	if (rhs_row != NULL) {
+		class_destroy(rhs_row);
+	}
+	if (out_row != NULL) {
+		class_destroy(out_row);
+	}
+}
+
+#define CLASS_STORE_NO_SLOT UINT32_MAX
+
+static ClassHandle class_store_make_handle(uint32_t slot, uint32_t generation)
+{
+	return (generation << CLASS_HANDLE_INDEX_BITS) | slot;
+}
+
+static Class* class_store_instance_at(const ClassStore* store, size_t index)
+{
+	return (Class*)(store->instances + store->stride * index);
+}
+
+// the slot of a live handle, or CLASS_STORE_NO_SLOT when the handle is stale or was never issued
+static uint32_t class_store_resolve(const ClassStore* store, ClassHandle handle)
+{
+	const uint32_t slot = handle & CLASS_HANDLE_INDEX_MASK;
+	const uint32_t generation = handle >> CLASS_HANDLE_INDEX_BITS;
+	if (store == NULL || slot >= store->num_slots || generation == 0) {
+		return CLASS_STORE_NO_SLOT;
+	}
+
+	if (store->generations[slot] != generation) {
+		return CLASS_STORE_NO_SLOT;
+	}
+
+	return slot;
+}
+
+ClassStore* class_store_create(const ClassType* type, size_t capacity)
+{
+	if (type == NULL) {
+		DEBUG_BREAK("invalid class type!");
+		return NULL;
+	}
+
+	ClassStore* store = (ClassStore*)malloc(sizeof(ClassStore));
+	if (store == NULL) {
+		return NULL;
+	}
+
+	store->type = type;
+	store->instances = NULL;
+	store->dense_slots = NULL;
+	store->slots = NULL;
+	store->generations = NULL;
+	store->stride = class_type_get_instance_size(type);
+	store->count = 0;
+	store->capacity = 0;
+	store->num_slots = 0;
+	store->slot_capacity = 0;
+	store->free_slot = CLASS_STORE_NO_SLOT;
+
+	if (class_store_reserve(store, capacity) == 0) {
+		class_store_destroy(store);
+		return NULL;
+	}
+
+	return store;
+}
+
+// destructors run for every live instance
+void class_store_destroy(ClassStore* store)
+{
+	if (store == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < store->count; i++) {
+		class_destroy_in_place(class_store_instance_at(store, i));
+	}
+
+	ALIGNED_FREE(store->instances);
+	free(store->dense_slots);
+	free(store->slots);
+	free(store->generations);
+	free(store);
+}
+
+static int class_store_reserve_slots(ClassStore* store, size_t slot_capacity)
+{
+	if (slot_capacity <= store->slot_capacity) {
+		return 1;
+	}
+
+	uint32_t* slots = (uint32_t*)realloc(store->slots, sizeof(uint32_t) * slot_capacity);
+	if (slots == NULL) {
+		return 0;
+	}
+	store->slots = slots;
+
+	uint32_t* generations = (uint32_t*)realloc(store->generations, sizeof(uint32_t) * slot_capacity);
+	if (generations == NULL) {
+		return 0;
+	}
+	store->generations = generations;
+
+	store->slot_capacity = slot_capacity;
+	return 1;
+}
+
+// instances move when the store grows, handles stay valid
+int class_store_reserve(ClassStore* store, size_t capacity)
+{
+	if (store == NULL) {
+		DEBUG_BREAK("invalid store!");
+		return 0;
+	}
+
+	if (capacity <= store->capacity) {
+		return 1;
+	}
+
+	if (capacity > CLASS_HANDLE_INDEX_MASK) {
+		DEBUG_BREAK("store capacity exceeds the handle index range!");
+		return 0;
+	}
+
+	unsigned char* instances = (unsigned char*)ALIGNED_MALLOC(store->stride * capacity, class_type_get_instance_alignment(store->type));
+	if (instances == NULL) {
+		return 0;
+	}
+
+	if (store->instances != NULL) {
+		memcpy(instances, store->instances, store->stride * store->count);
+		ALIGNED_FREE(store->instances);
+	}
+	store->instances = instances;
+
+	uint32_t* dense_slots = (uint32_t*)realloc(store->dense_slots, sizeof(uint32_t) * capacity);
+	if (dense_slots == NULL) {
+		return 0;
+	}
+	store->dense_slots = dense_slots;
+
+	// every dense entry owns a slot, only retired slots make the slot arrays outgrow the dense array
+	if (class_store_reserve_slots(store, capacity) == 0) {
+		return 0;
+	}
+
+	store->capacity = capacity;
+	return 1;
+}
+
+// takes a free slot, or a new one, for the next dense entry and returns its handle
+static ClassHandle class_store_push_slot(ClassStore* store)
+{
+	if (store->count == store->capacity) {
+		if (store->capacity >= CLASS_HANDLE_INDEX_MASK) {
+			DEBUG_BREAK("store is full!");
+			return CLASS_HANDLE_NONE;
+		}
+
+		size_t capacity = store->capacity > 0 ? store->capacity * 2 : 16;
+		if (capacity > CLASS_HANDLE_INDEX_MASK) {
+			capacity = CLASS_HANDLE_INDEX_MASK;
+		}
+		if (class_store_reserve(store, capacity) == 0) {
+			return CLASS_HANDLE_NONE;
+		}
+	}
+
+	uint32_t slot = store->free_slot;
+	if (slot != CLASS_STORE_NO_SLOT) {
+		store->free_slot = store->slots[slot];
+	} else {
+		if (store->num_slots == store->slot_capacity) {
+			if (store->num_slots >= CLASS_HANDLE_INDEX_MASK) {
+				DEBUG_BREAK("store has retired every slot!");
+				return CLASS_HANDLE_NONE;
+			}
+
+			size_t slot_capacity = store->slot_capacity * 2;
+			if (slot_capacity > CLASS_HANDLE_INDEX_MASK) {
+				slot_capacity = CLASS_HANDLE_INDEX_MASK;
+			}
+			if (class_store_reserve_slots(store, slot_capacity) == 0) {
+				return CLASS_HANDLE_NONE;
+			}
+		}
+		slot = (uint32_t)store->num_slots++;
+		store->generations[slot] = 1;
+	}
+
+	store->slots[slot] = (uint32_t)store->count;
+	store->dense_slots[store->count] = slot;
+	store->count++;
+
+	return class_store_make_handle(slot, store->generations[slot]);
+}
+
+// constructs a new instance at the end of the dense array
+ClassHandle class_store_add(ClassStore* store)
+{
+	if (store == NULL) {
+		DEBUG_BREAK("invalid store!");
+		return CLASS_HANDLE_NONE;
+	}
+
+	const ClassHandle handle = class_store_push_slot(store);
+	if (handle != CLASS_HANDLE_NONE) {
+		class_create_in_place(store->type, class_store_instance_at(store, store->count - 1));
+	}
+
+	return handle;
+}
+
+ClassHandle class_store_add_clone(ClassStore* store, const Class* klass)
+{
+	if (store == NULL || klass == NULL || class_get_type(klass) != store->type) {
+		DEBUG_BREAK("instance type does not match the store!");
+		return CLASS_HANDLE_NONE;
+	}
+
+	const ClassHandle handle = class_store_push_slot(store);
+	if (handle != CLASS_HANDLE_NONE) {
+		class_clone_in_place(klass, class_store_instance_at(store, store->count - 1));
+	}
+
+	return handle;
+}
+
+// destroys the instance and moves the last one into its place, removing a stale handle does nothing
+void class_store_remove(ClassStore* store, ClassHandle handle)
+{
+	const uint32_t slot = class_store_resolve(store, handle);
+	if (slot == CLASS_STORE_NO_SLOT) {
+		return;
+	}
+
+	const uint32_t index = store->slots[slot];
+	const size_t last = store->count - 1;
+	class_destroy_in_place(class_store_instance_at(store, index));
+
+	if (index != last) {
+		memcpy(class_store_instance_at(store, index), class_store_instance_at(store, last), store->stride);
+		const uint32_t moved_slot = store->dense_slots[last];
+		store->dense_slots[index] = moved_slot;
+		store->slots[moved_slot] = index;
+	}
+	store->count--;
+
+	// generation 0 is never issued, a slot that has used up every generation keeps it and is never reused
+	const uint32_t generation = store->generations[slot] + 1;
+	if (generation > CLASS_HANDLE_GENERATION_MASK) {
+		store->generations[slot] = 0;
+		return;
+	}
+	store->generations[slot] = generation;
+	store->slots[slot] = store->free_slot;
+	store->free_slot = slot;
+}
+
+int class_store_is_valid(const ClassStore* store, ClassHandle handle)
+{
+	return class_store_resolve(store, handle) != CLASS_STORE_NO_SLOT;
+}
+
+// the pointer is only valid until the next add or remove on the store
+Class* class_store_get(const ClassStore* store, ClassHandle handle)
+{
+	const uint32_t slot = class_store_resolve(store, handle);
+	if (slot == CLASS_STORE_NO_SLOT) {
+		return NULL;
+	}
+
+	return class_store_instance_at(store, store->slots[slot]);
+}
+
+size_t class_store_get_count(const ClassStore* store)
+{
+	if (store == NULL) {
+		return 0;
+	}
+
+	return store->count;
+}
+
+// iterates the dense array, index order changes whenever an instance is removed
+Class* class_store_get_instance(const ClassStore* store, size_t index)
+{
+	if (store == NULL || index >= store->count) {
+		DEBUG_BREAK("index out of bounds!");
+		return NULL;
+	}
+
+	return class_store_instance_at(store, index);
+}
+
+ClassHandle class_store_get_handle(const ClassStore* store, size_t index)
+{
+	if (store == NULL || index >= store->count) {
+		DEBUG_BREAK("index out of bounds!");
+		return CLASS_HANDLE_NONE;
+	}
+
+	const uint32_t slot = store->dense_slots[index];
+	return class_store_make_handle(slot, store->generations[slot]);
+}
+
+ClassDestroyQueue* class_destroy_queue_create(size_t capacity)
+{
+	ClassDestroyQueue* queue = (ClassDestroyQueue*)malloc(sizeof(ClassDestroyQueue));
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	queue->entries = NULL;
+	queue->count = 0;
+	queue->capacity = 0;
+	queue->flushing = NULL;
+	queue->flushing_capacity = 0;
+
+	if (capacity > 0) {
+		queue->entries = (ClassDeferredDestroy*)malloc(sizeof(ClassDeferredDestroy) * capacity);
+		if (queue->entries == NULL) {
+			free(queue);
+			return NULL;
+		}
+		queue->capacity = capacity;
+	}
+
+	if (mtx_init(&queue->lock, mtx_plain) != thrd_success) {
+		free(queue->entries);
+		free(queue);
+		return NULL;
+	}
+
+	if (mtx_init(&queue->flush_lock, mtx_plain) != thrd_success) {
+		mtx_destroy(&queue->lock);
+		free(queue->entries);
+		free(queue);
+		return NULL;
+	}
+
+	return queue;
+}
+
+// everything still queued is destroyed first
+void class_destroy_queue_destroy(ClassDestroyQueue* queue)
+{
+	if (queue == NULL) {
+		return;
+	}
+
+	class_destroy_queue_flush(queue);
+	mtx_destroy(&queue->lock);
+	mtx_destroy(&queue->flush_lock);
+	free(queue->entries);
+	free(queue->flushing);
+	free(queue);
+}
+
+void class_destroy_deferred(ClassDestroyQueue* queue, Class* klass)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	class_destroy_deferred_with_allocator(queue, klass, class_type_get_allocator(klass->type));
+}
+
+// the instance must not be used after this, without a queue it is destroyed immediately
+void class_destroy_deferred_with_allocator(ClassDestroyQueue* queue, Class* klass, const Allocator* allocator)
+{
+	if (klass == NULL) {
+		return;
+	}
+
+	if (queue == NULL) {
+		class_destroy_with_allocator(klass, allocator);
+		return;
+	}
+
+	mtx_lock(&queue->lock);
+	if (queue->count == queue->capacity) {
+		const size_t capacity = queue->capacity > 0 ? queue->capacity * 2 : 64;
+		ClassDeferredDestroy* entries = (ClassDeferredDestroy*)realloc(queue->entries, sizeof(ClassDeferredDestroy) * capacity);
+		if (entries == NULL) {
+			mtx_unlock(&queue->lock);
+			class_destroy_with_allocator(klass, allocator);
+			return;
+		}
+		queue->entries = entries;
+		queue->capacity = capacity;
+	}
+
+	queue->entries[queue->count].klass = klass;
+	queue->entries[queue->count].allocator = allocator;
+	queue->count++;
+	mtx_unlock(&queue->lock);
+}
+
+static int class_deferred_destroy_compare(const void* lhs, const void* rhs)
+{
+	const ClassDeferredDestroy* a = (const ClassDeferredDestroy*)lhs;
+	const ClassDeferredDestroy* b = (const ClassDeferredDestroy*)rhs;
+	const uintptr_t a_type = (uintptr_t)a->klass->type;
+	const uintptr_t b_type = (uintptr_t)b->klass->type;
+	if (a_type != b_type) {
+		return a_type < b_type ? -1 : 1;
+	}
+
+	const uintptr_t a_allocator = (uintptr_t)a->allocator;
+	const uintptr_t b_allocator = (uintptr_t)b->allocator;
+	return a_allocator < b_allocator ? -1 : a_allocator > b_allocator;
+}
+
+// runs every queued destructor, grouped by type, then frees the instances in a second pass.
+// can be called from any thread, including a background thread, and queueing continues meanwhile
+size_t class_destroy_queue_flush(ClassDestroyQueue* queue)
+{
+	if (queue == NULL) {
+		return 0;
+	}
+
+	mtx_lock(&queue->flush_lock);
+
+	// swap the pending list out so producers only ever wait for the swap
+	mtx_lock(&queue->lock);
+	ClassDeferredDestroy* entries = queue->entries;
+	const size_t capacity = queue->capacity;
+	const size_t count = queue->count;
+	queue->entries = queue->flushing;
+	queue->capacity = queue->flushing_capacity;
+	queue->count = 0;
+	queue->flushing = entries;
+	queue->flushing_capacity = capacity;
+	mtx_unlock(&queue->lock);
+
+	if (count > 1) {
+		qsort(entries, count, sizeof(ClassDeferredDestroy), class_deferred_destroy_compare);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		class_destroy_in_place(entries[i].klass);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		Class* klass = entries[i].klass;
+		CLASS_STAT(const size_t instance_size = class_type_get_instance_size(klass->type));
+		CLASS_STAT(class_stats_on_free(&((ClassType*)klass->type)->stats, instance_size));
+		CLASS_STAT(class_stats_on_free(&s_global_stats, instance_size));
+		allocator_free(entries[i].allocator, klass);
+	}
+
+	mtx_unlock(&queue->flush_lock);
+	return count;
+}
+
+size_t class_destroy_queue_get_pending(ClassDestroyQueue* queue)
+{
+	if (queue == NULL) {
+		return 0;
+	}
+
+	mtx_lock(&queue->lock);
+	const size_t count = queue->count;
+	mtx_unlock(&queue->lock);
+
+	return count;
+}
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include "windows.h"
+#elif defined(__unix__) || defined(__APPLE__)
+#include "unistd.h"
+#endif
+
+#define CLASS_THREAD_POOL_FALLBACK_WORKERS 4
+
+static size_t class_thread_pool_hardware_workers(void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (size_t)count : 1;
+#else
+	return CLASS_THREAD_POOL_FALLBACK_WORKERS;
+#endif
+}
+
+// takes the next chunk from the front of a range
+static int class_thread_pool_take(ClassWorkRange* range, size_t grain, size_t* begin, size_t* end)
+{
+	mtx_lock(&range->lock);
+	const int found = range->begin < range->end;
+	if (found) {
+		*begin = range->begin;
+		*end = range->end - range->begin > grain ? range->begin + grain : range->end;
+		range->begin = *end;
+	}
+	mtx_unlock(&range->lock);
+
+	return found;
+}
+
+// moves the back half of another worker's range into the thief's own range, ranges up to one grain are taken whole
+static int class_thread_pool_steal(ClassThreadPool* pool, size_t worker)
+{
+	for (size_t i = 1; i < pool->num_workers; i++) {
+		ClassWorkRange* victim = &pool->ranges[(worker + i) % pool->num_workers];
+
+		mtx_lock(&victim->lock);
+		const size_t remaining = victim->end - victim->begin;
+		const size_t begin = remaining > pool->grain ? victim->end - remaining / 2 : victim->begin;
+		const size_t end = victim->end;
+		victim->end = begin;
+		mtx_unlock(&victim->lock);
+
+		if (begin < end) {
+			ClassWorkRange* own = &pool->ranges[worker];
+			mtx_lock(&own->lock);
+			own->begin = begin;
+			own->end = end;
+			mtx_unlock(&own->lock);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// returns once neither the own range nor any other range has work left
+static void class_thread_pool_work(ClassThreadPool* pool, size_t worker)
+{
+	size_t begin = 0;
+	size_t end = 0;
+	for (;;) {
+		if (class_thread_pool_take(&pool->ranges[worker], pool->grain, &begin, &end)) {
+			pool->fn(pool->user_data, begin, end, worker);
+		} else if (class_thread_pool_steal(pool, worker) == 0) {
+			return;
+		}
+	}
+}
+
+static int class_thread_pool_thread(void* arg)
+{
+	ClassWorkRange* range = (ClassWorkRange*)arg;
+	ClassThreadPool* pool = range->pool;
+	const size_t worker = (size_t)(range - pool->ranges);
+	size_t generation = 0;
+
+	mtx_lock(&pool->lock);
+	for (;;) {
+		while (pool->shutdown == 0 && pool->generation == generation) {
+			cnd_wait(&pool->wake, &pool->lock);
+		}
+		if (pool->shutdown != 0) {
+			break;
+		}
+		generation = pool->generation;
+		mtx_unlock(&pool->lock);
+
+		class_thread_pool_work(pool, worker);
+
+		mtx_lock(&pool->lock);
+		if (--pool->active == 0) {
+			cnd_signal(&pool->done);
+		}
+	}
+	mtx_unlock(&pool->lock);
+
+	return 0;
+}
+
+// num_workers counts the calling thread, 0 uses one worker per hardware thread
+ClassThreadPool* class_thread_pool_create(size_t num_workers)
+{
+	if (num_workers == 0) {
+		num_workers = class_thread_pool_hardware_workers();
+	}
+
+	ClassThreadPool* pool = (ClassThreadPool*)malloc(sizeof(ClassThreadPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	pool->ranges = (ClassWorkRange*)calloc(num_workers, sizeof(ClassWorkRange));
+	pool->threads = num_workers > 1 ? (thrd_t*)malloc(sizeof(thrd_t) * (num_workers - 1)) : NULL;
+	if (pool->ranges == NULL || (num_workers > 1 && pool->threads == NULL)) {
+		free(pool->ranges);
+		free(pool->threads);
+		free(pool);
+		return NULL;
+	}
+
+	pool->num_workers = num_workers;
+	pool->generation = 0;
+	pool->active = 0;
+	pool->shutdown = 0;
+	pool->fn = NULL;
+	pool->user_data = NULL;
+	pool->grain = 1;
+	const int run_lock_ready = mtx_init(&pool->run_lock, mtx_plain) == thrd_success;
+	const int lock_ready = run_lock_ready && mtx_init(&pool->lock, mtx_plain) == thrd_success;
+	const int wake_ready = lock_ready && cnd_init(&pool->wake) == thrd_success;
+	const int done_ready = wake_ready && cnd_init(&pool->done) == thrd_success;
+
+	size_t num_range_locks = 0;
+	while (done_ready && num_range_locks < num_workers && mtx_init(&pool->ranges[num_range_locks].lock, mtx_plain) == thrd_success) {
+		pool->ranges[num_range_locks].pool = pool;
+		num_range_locks++;
+	}
+
+	// unwinds whatever was initialized before the first failure
+	if (num_range_locks < num_workers) {
+		for (size_t i = 0; i < num_range_locks; i++) {
+			mtx_destroy(&pool->ranges[i].lock);
+		}
+		if (done_ready) {
+			cnd_destroy(&pool->done);
+		}
+		if (wake_ready) {
+			cnd_destroy(&pool->wake);
+		}
+		if (lock_ready) {
+			mtx_destroy(&pool->lock);
+		}
+		if (run_lock_ready) {
+			mtx_destroy(&pool->run_lock);
+		}
+		free(pool->ranges);
+		free(pool->threads);
+		free(pool);
+		return NULL;
+	}
+
+	// a pool that could not start every thread runs with the ones it got
+	for (size_t i = 1; i < num_workers; i++) {
+		if (thrd_create(&pool->threads[i - 1], class_thread_pool_thread, &pool->ranges[i]) != thrd_success) {
+			for (size_t j = i; j < num_workers; j++) {
+				mtx_destroy(&pool->ranges[j].lock);
+			}
+			pool->num_workers = i;
+			break;
+		}
+	}
+
+	return pool;
+}
+
+void class_thread_pool_destroy(ClassThreadPool* pool)
+{
+	if (pool == NULL) {
+		return;
+	}
+
+	mtx_lock(&pool->lock);
+	pool->shutdown = 1;
+	cnd_broadcast(&pool->wake);
+	mtx_unlock(&pool->lock);
+
+	for (size_t i = 1; i < pool->num_workers; i++) {
+		thrd_join(pool->threads[i - 1], NULL);
+	}
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		mtx_destroy(&pool->ranges[i].lock);
+	}
+
+	mtx_destroy(&pool->run_lock);
+	mtx_destroy(&pool->lock);
+	cnd_destroy(&pool->wake);
+	cnd_destroy(&pool->done);
+	free(pool->ranges);
+	free(pool->threads);
+	free(pool);
+}
+
+// blocks until fn has been called on every chunk of [0, count). chunks never overlap, so fn only
+// needs to be safe against other chunks, worker is below class_thread_pool_get_num_workers and
+// can index per worker scratch state. runs from several threads are serialized, fn must not start another run
+void class_thread_pool_run(ClassThreadPool* pool, size_t count, size_t grain, ClassParallelFn fn, void* user_data)
+{
+	if (pool == NULL || fn == NULL) {
+		DEBUG_BREAK("invalid thread pool!");
+		return;
+	}
+
+	grain = grain > 0 ? grain : 1;
+	if (count == 0) {
+		return;
+	}
+
+	// a single chunk is not worth waking anybody for
+	if (count <= grain || pool->num_workers == 1) {
+		mtx_lock(&pool->run_lock);
+		fn(user_data, 0, count, 0);
+		mtx_unlock(&pool->run_lock);
+		return;
+	}
+
+	mtx_lock(&pool->run_lock);
+
+	const size_t share = count / pool->num_workers;
+	const size_t extra = count % pool->num_workers;
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		ClassWorkRange* range = &pool->ranges[i];
+		mtx_lock(&range->lock);
+		range->begin = share * i + (i < extra ? i : extra);
+		range->end = range->begin + share + (i < extra ? 1 : 0);
+		mtx_unlock(&range->lock);
+	}
+
+	pool->fn = fn;
+	pool->user_data = user_data;
+	pool->grain = grain;
+
+	mtx_lock(&pool->lock);
+	pool->active = pool->num_workers - 1;
+	pool->generation++;
+	cnd_broadcast(&pool->wake);
+	mtx_unlock(&pool->lock);
+
+	class_thread_pool_work(pool, 0);
+
+	mtx_lock(&pool->lock);
+	while (pool->active > 0) {
+		cnd_wait(&pool->done, &pool->lock);
+	}
+	mtx_unlock(&pool->lock);
+
+	mtx_unlock(&pool->run_lock);
+}
+
+size_t class_thread_pool_get_num_workers(const ClassThreadPool* pool)
+{
+	if (pool == NULL) {
+		return 0;
+	}
+
+	return pool->num_workers;
+}
+
+static ClassThreadPool* s_default_pool = NULL;
+static mtx_t s_default_pool_lock;
+static once_flag s_default_pool_once = ONCE_FLAG_INIT;
+
+static void class_thread_pool_default_init(void)
+{
+	mtx_init(&s_default_pool_lock, mtx_plain);
+}
+
+// created on first use with one worker per hardware thread
+ClassThreadPool* class_thread_pool_get_default(void)
+{
+	call_once(&s_default_pool_once, class_thread_pool_default_init);
+
+	mtx_lock(&s_default_pool_lock);
+	if (s_default_pool == NULL) {
+		s_default_pool = class_thread_pool_create(0);
+	}
+	ClassThreadPool* pool = s_default_pool;
+	mtx_unlock(&s_default_pool_lock);
+
+	return pool;
+}
+
+// joins the default pool's threads, the next parallel call starts a new pool
+void class_thread_pool_shutdown_default(void)
+{
+	call_once(&s_default_pool_once, class_thread_pool_default_init);
+
+	mtx_lock(&s_default_pool_lock);
+	class_thread_pool_destroy(s_default_pool);
+	s_default_pool = NULL;
+	mtx_unlock(&s_default_pool_lock);
+}
+
+// scratch instances are created per worker up front, so a pass allocates nothing per row
+typedef struct ClassParallelJob {
+	const Function* function;
+	ClassBatch* out;
+	const ClassBatch* lhs;
+	const ClassBatch* rhs;
+	ClassStore* store;
+	Class** scratch;
+	size_t scratch_per_worker;
+} ClassParallelJob;
+
+// every worker gets one instance of each type, stored next to each other
+static Class** class_parallel_create_scratch(const ClassType* const* types, size_t num_types, size_t num_workers)
+{
+	const size_t count = num_types * num_workers;
+	Class** scratch = (Class**)calloc(count, sizeof(Class*));
+	if (scratch == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		scratch[i] = class_create(types[i % num_types]);
+		if (scratch[i] == NULL) {
+			for (size_t j = 0; j < i; j++) {
+				class_destroy(scratch[j]);
+			}
+			free(scratch);
+			return NULL;
+		}
+	}
+
+	return scratch;
+}
+
+static void class_parallel_destroy_scratch(Class** scratch, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		class_destroy(scratch[i]);
+	}
+
+	free(scratch);
+}
+
+// only members the function changed are written back and marked dirty
+static void class_batch_parallel_unary(void* user_data, size_t begin, size_t end, size_t worker)
+{
+	const ClassParallelJob* job = (const ClassParallelJob*)user_data;
+	Class* instance = job->scratch[worker * job->scratch_per_worker];
+	const size_t num_members = class_get_num_members_unchecked(instance);
+
+	for (size_t i = begin; i < end; i++) {
+		const ClassBatchRow row = { job->out, i };
+		class_batch_row_load(row, instance);
+		job->function->fn(instance);
+
+		for (size_t m = 0; m < num_members; m++) {
+			void* column_value = class_batch_row_get_member_address(row, m);
+			const void* value = class_get_member_address_unchecked(instance, m);
+			const size_t size = member_get_size(class_get_member_unchecked(instance, m));
+			if (memcmp(column_value, value, size) != 0) {
+				memcpy(column_value, value, size);
+				class_batch_mark_dirty(job->out, i, class_member_dirty_bit(m));
+			}
+		}
+	}
+}
+
+static void class_batch_parallel_binary(void* user_data, size_t begin, size_t end, size_t worker)
+{
+	const ClassParallelJob* job = (const ClassParallelJob*)user_data;
+	Class* lhs_row = job->scratch[worker * job->scratch_per_worker];
+	Class* rhs_row = job->scratch[worker * job->scratch_per_worker + 1];
+	Class* out_row = job->scratch[worker * job->scratch_per_worker + 2];
+
+	for (size_t i = begin; i < end; i++) {
+		class_batch_row_load((ClassBatchRow){ (ClassBatch*)job->lhs, i }, lhs_row);
+		class_batch_row_load((ClassBatchRow){ (ClassBatch*)job->rhs, i }, rhs_row);
+		job->function->binary_member_into_fn(out_row, lhs_row, rhs_row);
+		class_batch_row_store((ClassBatchRow){ job->out, i }, out_row);
+	}
+}
+
+static void class_store_parallel_unary(void* user_data, size_t begin, size_t end, size_t worker)
+{
+	(void)worker;
+	const ClassParallelJob* job = (const ClassParallelJob*)user_data;
+	for (size_t i = begin; i < end; i++) {
+		job->function->fn(class_store_instance_at(job->store, i));
+	}
+}
+
+// applies a unary member function to every row in place, each row goes through a per worker scratch instance
+void class_batch_parallel_for(ClassBatch* batch, const Function* function, size_t grain)
+{
+	if (batch == NULL || function == NULL || function->fn == NULL) {
+		DEBUG_BREAK("function has no unary form!");
+		return;
+	}
+
+	ClassThreadPool* pool = class_thread_pool_get_default();
+	if (pool == NULL || batch->count == 0) {
+		return;
+	}
+
+	const size_t num_scratch = class_thread_pool_get_num_workers(pool);
+	ClassParallelJob job = { .function = function, .out = batch, .scratch_per_worker = 1 };
+	job.scratch = class_parallel_create_scratch(&batch->type, 1, num_scratch);
+	if (job.scratch == NULL) {
+		return;
+	}
+
+	class_thread_pool_run(pool, batch->count, grain > 0 ? grain : CLASS_PARALLEL_DEFAULT_GRAIN, class_batch_parallel_unary, &job);
+	class_parallel_destroy_scratch(job.scratch, num_scratch);
+}
+
+// parallel class_batch_invoke for functions with an in-place form. column kernels always start at row 0
+// and allocating functions would contend on the allocator, so both run through class_batch_invoke instead
+void class_batch_parallel_invoke(const Function* function, ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count, size_t grain)
+{
+	if (function == NULL || out == NULL || lhs == NULL || rhs == NULL) {
+		DEBUG_BREAK("invalid batch!");
+		return;
+	}
+
+	if (function->binary_member_into_fn == NULL) {
+		class_batch_invoke(function, out, lhs, rhs, count);
+		return;
+	}
+
+	if (count > class_batch_get_count(lhs) || count > class_batch_get_count(rhs)) {
+		DEBUG_BREAK("row out of bounds!");
+		return;
+	}
+
+	ClassThreadPool* pool = class_thread_pool_get_default();
+	if (pool == NULL || class_batch_prepare_out(out, count) == 0) {
+		return;
+	}
+
+	const ClassType* types[3] = { lhs->type, rhs->type, out->type };
+	const size_t num_scratch = class_thread_pool_get_num_workers(pool) * 3;
+	ClassParallelJob job = { .function = function, .out = out, .lhs = lhs, .rhs = rhs, .scratch_per_worker = 3 };
+	job.scratch = class_parallel_create_scratch(types, 3, class_thread_pool_get_num_workers(pool));
+	if (job.scratch == NULL) {
+		return;
+	}
+
+	class_thread_pool_run(pool, count, grain > 0 ? grain : CLASS_PARALLEL_DEFAULT_GRAIN, class_batch_parallel_binary, &job);
+	class_parallel_destroy_scratch(job.scratch, num_scratch);
+}
+
+// instances of a store are contiguous, so the function runs on them directly with no copies
+void class_store_parallel_for(ClassStore* store, const Function* function, size_t grain)
+{
+	if (store == NULL || function == NULL || function->fn == NULL) {
+		DEBUG_BREAK("function has no unary form!");
+		return;
+	}
+
+	ClassThreadPool* pool = class_thread_pool_get_default();
+	if (pool == NULL) {
+		return;
+	}
+
+	ClassParallelJob job = { .function = function, .store = store };
+	class_thread_pool_run(pool, store->count, grain > 0 ? grain : CLASS_PARALLEL_DEFAULT_GRAIN, class_store_parallel_unary, &job);
+}
+
+typedef enum ClassLaneOp {
+	CLASS_LANE_ADD,
+	CLASS_LANE_SUB,
+	CLASS_LANE_MUL,
+} ClassLaneOp;
+
+static void class_lanes_f32(ClassLaneOp op, float* out, const float* lhs, const float* rhs, size_t count)
+{
+	switch (op) {
+		case CLASS_LANE_ADD:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] + rhs[i];
+			}
+			return;
+		case CLASS_LANE_SUB:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] - rhs[i];
+			}
+			return;
+		case CLASS_LANE_MUL:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] * rhs[i];
+			}
+			return;
+	}
+}
+
+static void class_lanes_f64(ClassLaneOp op, double* out, const double* lhs, const double* rhs, size_t count)
+{
+	switch (op) {
+		case CLASS_LANE_ADD:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] + rhs[i];
+			}
+			return;
+		case CLASS_LANE_SUB:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] - rhs[i];
+			}
+			return;
+		case CLASS_LANE_MUL:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] * rhs[i];
+			}
+			return;
+	}
+}
+
+// i32 lanes go through here too, unsigned arithmetic wraps instead of overflowing and has the same bits
+static void class_lanes_u32(ClassLaneOp op, uint32_t* out, const uint32_t* lhs, const uint32_t* rhs, size_t count)
+{
+	switch (op) {
+		case CLASS_LANE_ADD:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] + rhs[i];
+			}
+			return;
+		case CLASS_LANE_SUB:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] - rhs[i];
+			}
+			return;
+		case CLASS_LANE_MUL:
+			for (size_t i = 0; i < count; i++) {
+				out[i] = lhs[i] * rhs[i];
+			}
+			return;
+	}
+}
+
+static void class_lanes_apply(ClassLaneOp op, MemberType lane_type, void* out, const void* lhs, const void* rhs, size_t count)
+{
+	switch (lane_type) {
+		case MEMBER_TYPE_F32: class_lanes_f32(op, (float*)out, (const float*)lhs, (const float*)rhs, count); return;
+		case MEMBER_TYPE_F64: class_lanes_f64(op, (double*)out, (const double*)lhs, (const double*)rhs, count); return;
+		case MEMBER_TYPE_I32:
+		case MEMBER_TYPE_U32: class_lanes_u32(op, (uint32_t*)out, (const uint32_t*)lhs, (const uint32_t*)rhs, count); return;
+		default: break;
+	}
+
+	DEBUG_BREAK("unknown lane type!");
+}
+
+static void class_lanes_scale_i32(int32_t* out, const int32_t* lanes, double scalar, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		out[i] = class_saturate_i32(lanes[i] * scalar);
+	}
+}
+
+static void class_lanes_scale_u32(uint32_t* out, const uint32_t* lanes, double scalar, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		out[i] = class_saturate_u32(lanes[i] * scalar);
+	}
+}
+
+static int class_operands_match(const Class* out, const Class* lhs, const Class* rhs)
+{
+	if (out == NULL || lhs == NULL || rhs == NULL || lhs->type != out->type || rhs->type != out->type) {
+		DEBUG_BREAK("operand type mismatch!");
+		return 0;
+	}
+
+	return 1;
+}
+
+// out may be one of the operands
+static void class_lanes_binary(ClassLaneOp op, Class* out, const Class* lhs, const Class* rhs)
+{
+	if (class_operands_match(out, lhs, rhs) == 0) {
+		return;
+	}
+
+	const ClassType* type = out->type;
+	for (size_t i = 0; i < type->num_lane_runs; i++) {
+		const ClassLaneRun* run = &type->lane_runs[i];
+		class_lanes_apply(op, run->lane_type, class_payload(out) + run->offset, class_payload(lhs) + run->offset, class_payload(rhs) + run->offset, run->lanes);
+	}
+
+	class_payload_written(out);
+}
+
+void class_add_into(Class* out, const Class* lhs, const Class* rhs)
+{
+	class_lanes_binary(CLASS_LANE_ADD, out, lhs, rhs);
+}
+
+void class_sub_into(Class* out, const Class* lhs, const Class* rhs)
+{
+	class_lanes_binary(CLASS_LANE_SUB, out, lhs, rhs);
+}
+
+void class_mul_into(Class* out, const Class* lhs, const Class* rhs)
+{
+	class_lanes_binary(CLASS_LANE_MUL, out, lhs, rhs);
+}
+
+// integer lanes follow the rules of ClassOperators, see c_class.h
+void class_scale_into(Class* out, const Class* klass, double scalar)
+{
+	if (class_operands_match(out, klass, klass) == 0) {
+		return;
+	}
+
+	const ClassType* type = out->type;
+	for (size_t i = 0; i < type->num_lane_runs; i++) {
+		const ClassLaneRun* run = &type->lane_runs[i];
+		unsigned char* destination = class_payload(out) + run->offset;
+		const unsigned char* source = class_payload(klass) + run->offset;
+		switch (run->lane_type) {
+			case MEMBER_TYPE_F32: {
+				const float s = (float)scalar;
+				for (size_t j = 0; j < run->lanes; j++) {
+					((float*)destination)[j] = ((const float*)source)[j] * s;
+				}
+				break;
+			}
+			case MEMBER_TYPE_F64:
+				for (size_t j = 0; j < run->lanes; j++) {
+					((double*)destination)[j] = ((const double*)source)[j] * scalar;
+				}
+				break;
+			case MEMBER_TYPE_I32:
+				class_lanes_scale_i32((int32_t*)destination, (const int32_t*)source, scalar, run->lanes);
+				break;
+			case MEMBER_TYPE_U32:
+				class_lanes_scale_u32((uint32_t*)destination, (const uint32_t*)source, scalar, run->lanes);
+				break;
+			default:
+				DEBUG_BREAK("unknown lane type!");
+				break;
+		}
+	}
+
+	class_payload_written(out);
+}
+
+double class_dot(const Class* lhs, const Class* rhs)
+{
+	if (class_operands_match(lhs, lhs, rhs) == 0) {
+		return 0.0;
+	}
+
+	double sum = 0.0;
+	const ClassType* type = lhs->type;
+	for (size_t i = 0; i < type->num_lane_runs; i++) {
+		const ClassLaneRun* run = &type->lane_runs[i];
+		const unsigned char* a = class_payload(lhs) + run->offset;
+		const unsigned char* b = class_payload(rhs) + run->offset;
+		switch (run->lane_type) {
+			case MEMBER_TYPE_F32:
+				for (size_t j = 0; j < run->lanes; j++) {
+					sum += (double)((const float*)a)[j] * ((const float*)b)[j];
+				}
+				break;
+			case MEMBER_TYPE_F64:
+				for (size_t j = 0; j < run->lanes; j++) {
+					sum += ((const double*)a)[j] * ((const double*)b)[j];
+				}
+				break;
+			case MEMBER_TYPE_I32:
+				for (size_t j = 0; j < run->lanes; j++) {
+					sum += (double)((const int32_t*)a)[j] * ((const int32_t*)b)[j];
+				}
+				break;
+			case MEMBER_TYPE_U32:
+				for (size_t j = 0; j < run->lanes; j++) {
+					sum += (double)((const uint32_t*)a)[j] * ((const uint32_t*)b)[j];
+				}
+				break;
+			default:
+				DEBUG_BREAK("unknown lane type!");
+				break;
+		}
+	}
+
+	return sum;
+}
+
+static Class* class_lanes_binary_new(ClassLaneOp op, const Class* lhs, const Class* rhs)
+{
+	if (lhs == NULL) {
+		DEBUG_BREAK("invalid class!");
+		return NULL;
+	}
+
+	Class* result = class_create(lhs->type);
+	if (result != NULL) {
+		class_lanes_binary(op, result, lhs, rhs);
+	}
+
+	return result;
+}
+
+static Class* class_add(const Class* lhs, const Class* rhs)
+{
+	return class_lanes_binary_new(CLASS_LANE_ADD, lhs, rhs);
+}
+
+static Class* class_sub(const Class* lhs, const Class* rhs)
+{
+	return class_lanes_binary_new(CLASS_LANE_SUB, lhs, rhs);
+}
+
+static Class* class_mul(const Class* lhs, const Class* rhs)
+{
+	return class_lanes_binary_new(CLASS_LANE_MUL, lhs, rhs);
+}
+
+// every member column holds count rows of its lanes back to back, so each member is one flat loop
+static void class_batch_lanes(ClassLaneOp op, ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count)
+{
+	if (out->type != lhs->type || out->type != rhs->type) {
+		DEBUG_BREAK("operand type mismatch!");
+		return;
+	}
+
+	const size_t num_members = class_type_get_num_members(out->type);
+	for (size_t i = 0; i < num_members; i++) {
+		const Member* member = class_type_get_member(out->type, i);
+		const MemberType lane_type = member_type_get_lane_type(member->type);
+		const size_t lanes = member_get_size(member) / member_type_get_size(lane_type);
+		class_lanes_apply(op, lane_type, out->columns[i], lhs->columns[i], rhs->columns[i], lanes * count);
+	}
+}
+
+static void class_batch_add(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count)
+{
+	class_batch_lanes(CLASS_LANE_ADD, out, lhs, rhs, count);
+}
+
+static void class_batch_sub(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count)
+{
+	class_batch_lanes(CLASS_LANE_SUB, out, lhs, rhs, count);
+}
+
+static void class_batch_mul(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count)
+{
+	class_batch_lanes(CLASS_LANE_MUL, out, lhs, rhs, count);
+}
+
+void class_expr_init(ClassExpr* expr)
+{
+	if (expr == NULL) {
+		return;
+	}
+
+	expr->type = NULL;
+	expr->num_nodes = 0;
+	expr->depth = 0;
+	expr->valid = 1;
+}
+
+// a malformed expression stays invalid and refuses to evaluate
+static void class_expr_append(ClassExpr* expr, ClassExprOp op, const Class* operand, double scalar, size_t pops)
+{
+	if (expr == NULL || expr->valid == 0) {
+		return;
+	}
+
+	if (expr->num_nodes == CLASS_EXPR_MAX_NODES || expr->depth < pops || expr->depth - pops + 1 > CLASS_EXPR_MAX_DEPTH) {
+		DEBUG_BREAK("invalid expression!");
+		expr->valid = 0;
+		return;
+	}
+
+	ClassExprNode* node = &expr->nodes[expr->num_nodes++];
+	node->op = op;
+	node->operand = operand;
+	node->scalar = scalar;
+	expr->depth = expr->depth - pops + 1;
+}
+
+void class_expr_push(ClassExpr* expr, const Class* operand)
+{
+	if (expr == NULL || operand == NULL || (expr->type != NULL && operand->type != expr->type)) {
+		DEBUG_BREAK("operand type mismatch!");
+		if (expr != NULL) {
+			expr->valid = 0;
+		}
+		return;
+	}
+
+	expr->type = operand->type;
+	class_expr_append(expr, CLASS_EXPR_PUSH, operand, 0.0, 0);
+}
+
+void class_expr_add(ClassExpr* expr)
+{
+	class_expr_append(expr, CLASS_EXPR_ADD, NULL, 0.0, 2);
+}
+
+void class_expr_sub(ClassExpr* expr)
+{
+	class_expr_append(expr, CLASS_EXPR_SUB, NULL, 0.0, 2);
+}
+
+void class_expr_mul(ClassExpr* expr)
+{
+	class_expr_append(expr, CLASS_EXPR_MUL, NULL, 0.0, 2);
+}
+
+void class_expr_scale(ClassExpr* expr, double scalar)
+{
+	class_expr_append(expr, CLASS_EXPR_SCALE, NULL, scalar, 1);
+}
+
+static void class_expr_load(MemberType lane_type, const unsigned char* source, double* lanes, size_t count)
+{
+	if (lane_type == MEMBER_TYPE_F32) {
+		for (size_t i = 0; i < count; i++) {
+			lanes[i] = ((const float*)source)[i];
+		}
+		return;
+	}
+
+	memcpy(lanes, source, sizeof(double) * count);
+}
+
+static void class_expr_store(MemberType lane_type, unsigned char* destination, const double* lanes, size_t count)
+{
+	if (lane_type == MEMBER_TYPE_F32) {
+		for (size_t i = 0; i < count; i++) {
+			((float*)destination)[i] = (float)lanes[i];
+		}
+		return;
+	}
+
+	memcpy(destination, lanes, sizeof(double) * count);
+}
+
+static ClassLaneOp class_expr_get_lane_op(ClassExprOp op)
+{
+	switch (op) {
+		case CLASS_EXPR_SUB: return CLASS_LANE_SUB;
+		case CLASS_EXPR_MUL: return CLASS_LANE_MUL;
+		default: return CLASS_LANE_ADD;
+	}
+}
+
+// integer lanes are not folded through double, every node applies the same rule as its operator
+// so an expression gives the bits a chain of class_*_into calls would
+static void class_expr_eval_integer(const ClassExpr* expr, MemberType lane_type, Class* out, size_t offset, size_t count)
+{
+	uint32_t stack[CLASS_EXPR_MAX_DEPTH][CLASS_EXPR_CHUNK];
+	size_t top = 0;
+
+	for (size_t n = 0; n < expr->num_nodes; n++) {
+		const ClassExprNode* node = &expr->nodes[n];
+		switch (node->op) {
+			case CLASS_EXPR_PUSH:
+				memcpy(stack[top++], class_payload(node->operand) + offset, sizeof(uint32_t) * count);
+				break;
+			case CLASS_EXPR_ADD:
+			case CLASS_EXPR_SUB:
+			case CLASS_EXPR_MUL:
+				top--;
+				class_lanes_u32(class_expr_get_lane_op(node->op), stack[top - 1], stack[top - 1], stack[top], count);
+				break;
+			case CLASS_EXPR_SCALE:
+				if (lane_type == MEMBER_TYPE_I32) {
+					class_lanes_scale_i32((int32_t*)stack[top - 1], (const int32_t*)stack[top - 1], node->scalar, count);
+				} else {
+					class_lanes_scale_u32(stack[top - 1], stack[top - 1], node->scalar, count);
+				}
+				break;
+		}
+	}
+
+	memcpy(class_payload(out) + offset, stack[0], sizeof(uint32_t) * count);
+}
+
+// runs the whole program over one chunk of lanes at a time, the chunk stack stays in l1 and every
+// operand is read exactly once. out may be one of the operands, a chunk is stored after all its loads
+int class_expr_eval_into(const ClassExpr* expr, Class* out)
+{
+	if (expr == NULL || out == NULL || expr->valid == 0 || expr->depth != 1 || out->type != expr->type) {
+		DEBUG_BREAK("invalid expression!");
+		return 0;
+	}
+
+	double stack[CLASS_EXPR_MAX_DEPTH][CLASS_EXPR_CHUNK];
+	const ClassType* type = expr->type;
+	for (size_t i = 0; i < type->num_lane_runs; i++) {
+		const ClassLaneRun* run = &type->lane_runs[i];
+		const size_t lane_size = member_type_get_size(run->lane_type);
+
+		for (size_t begin = 0; begin < run->lanes; begin += CLASS_EXPR_CHUNK) {
+			const size_t count = run->lanes - begin < CLASS_EXPR_CHUNK ? run->lanes - begin : CLASS_EXPR_CHUNK;
+			const size_t offset = run->offset + begin * lane_size;
+			if (run->lane_type == MEMBER_TYPE_I32 || run->lane_type == MEMBER_TYPE_U32) {
+				class_expr_eval_integer(expr, run->lane_type, out, offset, count);
+				continue;
+			}
+
+			size_t top = 0;
+
+			for (size_t n = 0; n < expr->num_nodes; n++) {
+				const ClassExprNode* node = &expr->nodes[n];
+				switch (node->op) {
+					case CLASS_EXPR_PUSH:
+						class_expr_load(run->lane_type, class_payload(node->operand) + offset, stack[top++], count);
+						break;
+					case CLASS_EXPR_ADD:
+						top--;
+						for (size_t j = 0; j < count; j++) {
+							stack[top - 1][j] += stack[top][j];
+						}
+						break;
+					case CLASS_EXPR_SUB:
+						top--;
+						for (size_t j = 0; j < count; j++) {
+							stack[top - 1][j] -= stack[top][j];
+						}
+						break;
+					case CLASS_EXPR_MUL:
+						top--;
+						for (size_t j = 0; j < count; j++) {
+							stack[top - 1][j] *= stack[top][j];
+						}
+						break;
+					case CLASS_EXPR_SCALE:
+						for (size_t j = 0; j < count; j++) {
+							stack[top - 1][j] *= node->scalar;
+						}
+						break;
+				}
+			}
+
+			class_expr_store(run->lane_type, class_payload(out) + offset, stack[0], count);
+		}
+	}
+
+	class_payload_written(out);
+	return 1;
+}
+
+// one finished call. names are kept as atoms and resolved when the trace is exported
+typedef struct ClassTraceEvent {
+	ClassTraceKind kind;
+	NameAtom type;
+	NameAtom function;
+	uint64_t begin;
+	uint64_t duration;
+} ClassTraceEvent;
+
+// only the owning thread advances head, start is moved by class_trace_clear.
+// buffers outlive their threads so the events of finished workers are still exported
+typedef struct ClassTraceBuffer {
+	struct ClassTraceBuffer* next;
+	uint32_t thread_id;
+	atomic_size_t head;
+	atomic_size_t start;
+	ClassTraceEvent events[CLASS_TRACE_BUFFER_CAPACITY];
+} ClassTraceBuffer;
+
+static _Atomic(ClassTraceBuffer*) s_trace_buffers = NULL;
+static atomic_uint s_trace_next_thread_id = 0;
+static atomic_size_t s_trace_generation = 0;
+static THREAD_LOCAL ClassTraceBuffer* s_trace_buffer = NULL;
+static THREAD_LOCAL size_t s_trace_buffer_generation = 0;
+
+// nanoseconds from a monotonic clock, wall clock time can jump backwards between two events.
+// timespec_get is only the fallback where neither counter is available
+uint64_t class_trace_now(void)
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	const uint64_t ticks = (uint64_t)counter.QuadPart;
+	const uint64_t ticks_per_second = (uint64_t)frequency.QuadPart;
+	return ticks / ticks_per_second * 1000000000ull + ticks % ticks_per_second * 1000000000ull / ticks_per_second;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// the first traced call of a thread allocates its buffer and pushes it onto the global list
+static ClassTraceBuffer* class_trace_get_buffer(void)
+{
+	const size_t generation = atomic_load_explicit(&s_trace_generation, memory_order_acquire);
+	if (s_trace_buffer != NULL && s_trace_buffer_generation == generation) {
+		return s_trace_buffer;
+	}
+
+	ClassTraceBuffer* buffer = (ClassTraceBuffer*)malloc(sizeof(ClassTraceBuffer));
+	if (buffer == NULL) {
+		return NULL;
+	}
+
+	buffer->thread_id = atomic_fetch_add_explicit(&s_trace_next_thread_id, 1, memory_order_relaxed) + 1;
+	atomic_init(&buffer->head, 0);
+	atomic_init(&buffer->start, 0);
+	buffer->next = atomic_load_explicit(&s_trace_buffers, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(&s_trace_buffers, &buffer->next, buffer, memory_order_release, memory_order_relaxed)) {
+	}
+
+	s_trace_buffer = buffer;
+	s_trace_buffer_generation = generation;
+	return buffer;
+}
+
+static void class_trace_record(ClassTraceKind kind, NameAtom type, NameAtom function, uint64_t begin)
+{
+	const uint64_t end = class_trace_now();
+	ClassTraceBuffer* buffer = class_trace_get_buffer();
+	if (buffer == NULL) {
+		return;
+	}
+
+	const size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	ClassTraceEvent* event = &buffer->events[head & (CLASS_TRACE_BUFFER_CAPACITY - 1)];
+	event->kind = kind;
+	event->type = type;
+	event->function = function;
+	event->begin = begin;
+	event->duration = end - begin;
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+// the pending events are the last CLASS_TRACE_BUFFER_CAPACITY written since the last clear
+static size_t class_trace_buffer_get_first(ClassTraceBuffer* buffer, size_t head)
+{
+	const size_t start = atomic_load_explicit(&buffer->start, memory_order_relaxed);
+	const size_t oldest = head > CLASS_TRACE_BUFFER_CAPACITY ? head - CLASS_TRACE_BUFFER_CAPACITY : 0;
+	return start > oldest && start <= head ? start : oldest;
+}
+
+void class_trace_set_enabled(int enabled)
+{
+	atomic_store_explicit(&s_trace_enabled, enabled != 0, memory_order_relaxed);
+}
+
+int class_trace_is_enabled(void)
+{
+	return atomic_load_explicit(&s_trace_enabled, memory_order_relaxed);
+}
+
+size_t class_trace_get_num_events(void)
+{
+	size_t count = 0;
+	for (ClassTraceBuffer* buffer = atomic_load_explicit(&s_trace_buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next) {
+		const size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+		count += head - class_trace_buffer_get_first(buffer, head);
+	}
+
+	return count;
+}
+
+// drops every pending event, threads keep their buffers
+void class_trace_clear(void)
+{
+	for (ClassTraceBuffer* buffer = atomic_load_explicit(&s_trace_buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next) {
+		atomic_store_explicit(&buffer->start, atomic_load_explicit(&buffer->head, memory_order_acquire), memory_order_relaxed);
+	}
+}
+
+static const char* class_trace_kind_get_name(ClassTraceKind kind)
+{
+	switch (kind) {
+		case CLASS_TRACE_CONSTRUCTOR: return "ctor";
+		case CLASS_TRACE_DESTRUCTOR: return "dtor";
+		case CLASS_TRACE_MEMBER_FUNCTION: return "function";
+		case CLASS_TRACE_BATCH: return "batch";
+	}
+
+	DEBUG_BREAK("unknown trace kind!");
+	return "function";
+}
+
+static void class_trace_write_string(FILE* file, const char* string)
+{
+	char escaped[6];
+	for (const char* c = string; *c != '\0'; c++) {
+		fwrite(escaped, 1, json_escape_char(*c, escaped), file);
+	}
+}
+
+// one complete event per call, timestamps are microseconds with the nanoseconds kept as decimals.
+// tracing may stay on, an event the owner overwrites while it is being copied is skipped
+int class_trace_export_chrome(FILE* file)
+{
+	if (file == NULL) {
+		DEBUG_BREAK("invalid trace file!");
+		return 0;
+	}
+
+	int first = 1;
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+	for (ClassTraceBuffer* buffer = atomic_load_explicit(&s_trace_buffers, memory_order_acquire); buffer != NULL; buffer = buffer->next) {
+		const size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+		for (size_t i = class_trace_buffer_get_first(buffer, head); i < head; i++) {
+			const ClassTraceEvent event = buffer->events[i & (CLASS_TRACE_BUFFER_CAPACITY - 1)];
+			atomic_thread_fence(memory_order_acquire);
+			if (atomic_load_explicit(&buffer->head, memory_order_relaxed) - i > CLASS_TRACE_BUFFER_CAPACITY) {
+				continue;
+			}
+
+			const char* type = event.type != NAME_ATOM_NONE ? name_atom_get_string(event.type) : "?";
+			const char* kind = class_trace_kind_get_name(event.kind);
+			const char* function = event.function != NAME_ATOM_NONE ? name_atom_get_string(event.function) : kind;
+			fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+			class_trace_write_string(file, type);
+			fputs("::", file);
+			class_trace_write_string(file, function);
+			fprintf(file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":1,\"tid\":%u}", kind,
+				(unsigned long long)(event.begin / 1000), (unsigned)(event.begin % 1000),
+				(unsigned long long)(event.duration / 1000), (unsigned)(event.duration % 1000), buffer->thread_id);
+			first = 0;
+		}
+	}
+	fputs("\n]}\n", file);
+
+	return ferror(file) == 0;
+}
+
+// frees every buffer, no traced call may be running. threads allocate a new buffer on their next traced call
+void class_trace_shutdown(void)
+{
+	class_trace_set_enabled(0);
+	ClassTraceBuffer* buffer = atomic_exchange_explicit(&s_trace_buffers, NULL, memory_order_acq_rel);
+	atomic_fetch_add_explicit(&s_trace_generation, 1, memory_order_release);
+	while (buffer != NULL) {
+		ClassTraceBuffer* next = buffer->next;
+		free(buffer);
+		buffer = next;
+	}
+}
@@ -0,0 +1,990 @@
+#ifndef C_CLASS_H
+#define C_CLASS_H
+
+#include "stdio.h"
+#include "stdint.h"
+#include "stdlib.h"
+#include "stddef.h"
+#include "string.h"
+#include "stdatomic.h"
+#include "threads.h"
+
+// define C_CLASS_SHARED to build or use the library as a dll or shared object, c_class.c sets C_CLASS_BUILD.
+// the fast-path accessors are static inline in this header, everything else is inlined across
+// translation units by building with link time optimization (/GL and /LTCG, -flto)
+// or by compiling c_class.c into the same translation unit as its callers
+#if defined(C_CLASS_SHARED)
+#if defined(_MSC_VER)
+#if defined(C_CLASS_BUILD)
+#define C_CLASS_API __declspec(dllexport)
+#else
+#define C_CLASS_API __declspec(dllimport)
+#endif
+#else
+#define C_CLASS_API __attribute__((visibility("default")))
+#endif
+#else
+#define C_CLASS_API
+#endif
+
+// breaks into an attached debugger and can be continued past. without __builtin_debugtrap GCC raises SIGTRAP
+// from class_debug_break, so signal.h stays out of this header
+C_CLASS_API void class_debug_break(void);
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_debugtrap)
+#define CLASS_HAS_DEBUGTRAP 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define DEBUG_BREAK(msg) __debugbreak();
+#elif defined(CLASS_HAS_DEBUGTRAP)
+#define DEBUG_BREAK(msg) __builtin_debugtrap();
+#elif defined(__GNUC__) || defined(__clang__)
+#define DEBUG_BREAK(msg) class_debug_break();
+#else
+#define DEBUG_BREAK(msg) abort();
+#endif
+#define STRINGIFY(s) #s
+
+// allocation and lifetime counters, on by default in debug builds
+#if !defined(CLASS_ENABLE_STATS)
+#if defined(NDEBUG)
+#define CLASS_ENABLE_STATS 0
+#else
+#define CLASS_ENABLE_STATS 1
+#endif
+#endif
+
+#if CLASS_ENABLE_STATS
+#define CLASS_STAT(statement) statement
+#else
+#define CLASS_STAT(statement)
+#endif
+
+// call tracing hooks, compiled in by default and switched on at runtime with class_trace_set_enabled
+#if !defined(CLASS_ENABLE_TRACING)
+#define CLASS_ENABLE_TRACING 1
+#endif
+
+// how much the accessors check their arguments, full in debug builds and none in release builds.
+// full breaks on NULL arguments and out of bounds indices and then returns a default,
+// assert only breaks, none leaves every accessor a raw field load
+#define CLASS_CHECK_NONE 0
+#define CLASS_CHECK_ASSERT 1
+#define CLASS_CHECK_FULL 2
+
+#if !defined(CLASS_CHECK_LEVEL)
+#if defined(NDEBUG)
+#define CLASS_CHECK_LEVEL CLASS_CHECK_NONE
+#else
+#define CLASS_CHECK_LEVEL CLASS_CHECK_FULL
+#endif
+#endif
+
+#if CLASS_CHECK_LEVEL == CLASS_CHECK_FULL
+#define CLASS_CHECK(condition, msg, fallback) if (!(condition)) { DEBUG_BREAK(msg); return fallback; }
+#define CLASS_CHECK_NULL(pointer, fallback) if ((pointer) == NULL) { DEBUG_BREAK("null argument!"); return fallback; }
+#elif CLASS_CHECK_LEVEL == CLASS_CHECK_ASSERT
+#define CLASS_CHECK(condition, msg, fallback) if (!(condition)) { DEBUG_BREAK(msg); }
+#define CLASS_CHECK_NULL(pointer, fallback) if ((pointer) == NULL) { DEBUG_BREAK("null argument!"); }
+#else
+#define CLASS_CHECK(condition, msg, fallback)
+#define CLASS_CHECK_NULL(pointer, fallback)
+#endif
+
+// checks that guard hot paths, compiled out unless checking is enabled
+#if CLASS_CHECK_LEVEL >= CLASS_CHECK_ASSERT
+#define CLASS_ASSERT(condition, msg) if (!(condition)) { DEBUG_BREAK(msg); }
+#else
+#define CLASS_ASSERT(condition, msg)
+#endif
+
+typedef enum MemberType {
+	MEMBER_TYPE_F32,
+	MEMBER_TYPE_F64,
+	MEMBER_TYPE_I32,
+	MEMBER_TYPE_U32,
+	MEMBER_TYPE_F32X2,
+	MEMBER_TYPE_F32X4,
+	MEMBER_TYPE_F32X8,
+	MEMBER_TYPE_F32_ARRAY,
+} MemberType;
+
+C_CLASS_API const char* member_type_to_string(MemberType type);
+C_CLASS_API size_t member_type_get_size(MemberType type);
+C_CLASS_API size_t member_type_get_alignment(MemberType type);
+C_CLASS_API MemberType member_type_get_lane_type(MemberType type);
+
+typedef union MemberData {
+	float f_data;
+	double d_data;
+	int32_t i_data;
+	uint32_t u_data;
+	float v_data[2];
+} MemberData;
+
+C_CLASS_API MemberData member_data_load(MemberType type, const void* source);
+C_CLASS_API void member_data_store(MemberType type, void* destination, MemberData data);
+
+// an interned name, equal names always have equal atoms, see name_intern
+typedef uint32_t NameAtom;
+
+#define NAME_ATOM_NONE 0u
+
+// describes one member of a type, data is the default value
+// and offset is the member's position in the instance payload, computed by the type.
+// count is the number of elements of an f32[] member and is ignored by every other type.
+// types replace name with the interned copy and fill in atom, invalidates is the mask of
+// computed members that read this member and is also maintained by the type
+typedef struct Member {
+	MemberData data;
+	char* name;
+	MemberType type;
+	uint32_t offset;
+	uint32_t count;
+	NameAtom atom;
+	uint64_t invalidates;
+} Member;
+
+C_CLASS_API const char* member_get_name(const Member* member);
+C_CLASS_API NameAtom member_get_atom(const Member* member);
+C_CLASS_API MemberType member_get_type(const Member* member);
+C_CLASS_API MemberData member_get_data(const Member* member);
+C_CLASS_API size_t member_get_size(const Member* member);
+C_CLASS_API size_t member_get_alignment(const Member* member);
+
+typedef struct Class Class;
+typedef struct ClassBatch ClassBatch;
+
+typedef enum FunctionType {
+	FUNCTION_TYPE_CONSTRUCTOR,
+	FUNCTION_TYPE_DESTRUCTOR,
+	FUNCTION_TYPE_MEMBER_FUNCTION,
+} FunctionType;
+
+typedef void (*UnaryMemberFn) (const Class*);
+typedef Class* (*BinaryMemberFn) (const Class*, const Class*);
+typedef void (*BinaryMemberIntoFn) (Class*, const Class*, const Class*);
+typedef void (*BatchMemberFn) (ClassBatch*, const ClassBatch*, const ClassBatch*, size_t);
+// runs instead of the constructor on clones and copy-on-write copies, after the payload was copied
+typedef void (*CopyMemberFn) (Class* clone, const Class* source);
+
+typedef struct Function {
+	char* name;
+	FunctionType type;
+	NameAtom atom;
+	UnaryMemberFn fn;
+	BinaryMemberFn binary_member_fn;
+	BinaryMemberIntoFn binary_member_into_fn;
+	BatchMemberFn batch_fn;
+} Function;
+
+C_CLASS_API const char* function_get_name(const Function* function);
+C_CLASS_API NameAtom function_get_atom(const Function* function);
+C_CLASS_API FunctionType function_get_type(const Function* function);
+C_CLASS_API Class* function_invoke(const Function* function, const Class* klass, const Class* other);
+C_CLASS_API void function_invoke_into(const Function* function, Class* out, const Class* klass, const Class* other);
+
+#define ALLOCATOR_ALIGNMENT 16
+#define ALIGN_UP(size, alignment) (((size) + ((alignment) - 1)) & ~((size_t)(alignment) - 1))
+
+#if defined(_MSC_VER)
+#include "malloc.h"
+#define ALIGNED_MALLOC(size, alignment) _aligned_malloc(size, alignment)
+#define ALIGNED_FREE(memory) _aligned_free(memory)
+#else
+#define ALIGNED_MALLOC(size, alignment) aligned_alloc(alignment, ALIGN_UP(size, alignment))
+#define ALIGNED_FREE(memory) free(memory)
+#endif
+
+// alignment is a power of two, every allocator has to honour at least ALLOCATOR_ALIGNMENT
+typedef struct Allocator {
+	void* (*alloc) (void* user_data, size_t size, size_t alignment);
+	void (*free) (void* user_data, void* memory);
+	void* user_data;
+} Allocator;
+
+C_CLASS_API void* allocator_alloc(const Allocator* allocator, size_t size);
+C_CLASS_API void* allocator_alloc_aligned(const Allocator* allocator, size_t size, size_t alignment);
+C_CLASS_API void allocator_free(const Allocator* allocator, void* memory);
+C_CLASS_API const Allocator* allocator_get_default(void);
+
+// fixed-size blocks carved out of chunks, freed blocks are pushed onto an intrusive free list
+typedef struct PoolChunk {
+	struct PoolChunk* next;
+} PoolChunk;
+
+typedef struct Pool {
+	size_t block_size;
+	size_t blocks_per_chunk;
+	size_t alignment;
+	void* free_list;
+	PoolChunk* chunks;
+	Allocator allocator;
+} Pool;
+
+C_CLASS_API Pool* pool_create(size_t block_size, size_t blocks_per_chunk);
+C_CLASS_API Pool* pool_create_aligned(size_t block_size, size_t blocks_per_chunk, size_t alignment);
+C_CLASS_API void pool_destroy(Pool* pool);
+C_CLASS_API void* pool_alloc(Pool* pool);
+C_CLASS_API void pool_free(Pool* pool, void* memory);
+C_CLASS_API const Allocator* pool_get_allocator(const Pool* pool);
+
+// bump allocator, individual frees are no-ops and arena_reset releases everything at once
+typedef struct Arena {
+	unsigned char* buffer;
+	size_t capacity;
+	size_t offset;
+	Allocator allocator;
+} Arena;
+
+C_CLASS_API Arena* arena_create(size_t capacity);
+C_CLASS_API void arena_destroy(Arena* arena);
+C_CLASS_API void* arena_alloc(Arena* arena, size_t size);
+C_CLASS_API void* arena_alloc_aligned(Arena* arena, size_t size, size_t alignment);
+C_CLASS_API void arena_reset(Arena* arena);
+C_CLASS_API size_t arena_get_used(const Arena* arena);
+C_CLASS_API const Allocator* arena_get_allocator(const Arena* arena);
+
+#define NAME_TABLE_EMPTY UINT32_MAX
+#define CLASS_INVALID_SLOT SIZE_MAX
+
+// process wide, thread safe intern table. every distinct name is copied once and never moves,
+// the strings stay valid until name_intern_shutdown
+C_CLASS_API uint32_t name_hash(const char* name);
+C_CLASS_API NameAtom name_intern(const char* name);
+C_CLASS_API NameAtom name_lookup(const char* name);
+C_CLASS_API const char* name_atom_get_string(NameAtom atom);
+C_CLASS_API size_t name_intern_get_count(void);
+C_CLASS_API void name_intern_shutdown(void);
+
+// open-addressing hash from an atom to the index of the element that carries it
+typedef struct NameTableEntry {
+	NameAtom atom;
+	uint32_t index;
+} NameTableEntry;
+
+typedef struct NameTable {
+	NameTableEntry* entries;
+	size_t capacity;
+} NameTable;
+
+C_CLASS_API int name_table_build(NameTable* table, const void* elements, size_t count, size_t stride, size_t atom_offset);
+C_CLASS_API void name_table_free(NameTable* table);
+C_CLASS_API size_t name_table_find(const NameTable* table, NameAtom atom);
+
+typedef struct ClassStats {
+	size_t live_instances;
+	size_t total_allocations;
+	size_t total_frees;
+	size_t bytes_in_use;
+	size_t peak_bytes_in_use;
+	size_t ctor_calls;
+	size_t copy_calls;
+	size_t dtor_calls;
+} ClassStats;
+
+// live counters are atomic so instances can be created and destroyed from any thread
+typedef struct ClassStatCounters {
+	atomic_size_t live_instances;
+	atomic_size_t total_allocations;
+	atomic_size_t total_frees;
+	atomic_size_t bytes_in_use;
+	atomic_size_t peak_bytes_in_use;
+	atomic_size_t ctor_calls;
+	atomic_size_t copy_calls;
+	atomic_size_t dtor_calls;
+} ClassStatCounters;
+
+C_CLASS_API ClassStats class_stats_get_global(void);
+C_CLASS_API void class_stats_reset_global(void);
+C_CLASS_API void class_stats_debug_print(const char* label, const ClassStats* stats);
+
+typedef void (*ComputedMemberFn) (const Class* klass, void* out);
+
+// a member derived from stored members. fn writes the value to out and only runs on the first read
+// after one of the dependencies was written, the result is cached in the instance at offset.
+// dependencies has the dirty bit of every stored member fn reads
+typedef struct ComputedMember {
+	char* name;
+	NameAtom atom;
+	MemberType type;
+	uint32_t offset;
+	uint64_t dependencies;
+	ComputedMemberFn fn;
+} ComputedMember;
+
+#define CLASS_MAX_COMPUTED_MEMBERS 64
+
+// consecutive payload lanes of one scalar type. the type merges adjacent members into runs,
+// so e.g. the x and y of a Vec2 are a single run of two f32 lanes
+typedef struct ClassLaneRun {
+	MemberType lane_type;
+	uint32_t offset;
+	uint32_t lanes;
+} ClassLaneRun;
+
+// element-wise operators generated for every type from its lane runs, they work on any member layout.
+// scale multiplies every lane by the scalar and dot sums the lane products.
+// on integer lanes add, sub and mul wrap modulo 2^32, scale multiplies in double, truncates toward zero
+// and saturates to the range of the lane with NaN giving 0
+typedef struct ClassOperators {
+	BinaryMemberIntoFn add;
+	BinaryMemberIntoFn sub;
+	BinaryMemberIntoFn mul;
+	void (*scale) (Class* out, const Class* klass, double scalar);
+	double (*dot) (const Class* lhs, const Class* rhs);
+} ClassOperators;
+
+typedef struct ClassType {
+	char* name;
+	NameAtom atom;
+	const struct ClassType* base;
+	size_t num_base_members;
+	Function ctor;
+	Function dtor;
+	CopyMemberFn copy;
+	Member* members;
+	size_t num_members;
+	size_t member_capacity;
+	Function* functions;
+	size_t num_functions;
+	size_t function_capacity;
+	Allocator allocator;
+	NameTable member_table;
+	NameTable function_table;
+	size_t payload_size;
+	size_t payload_alignment;
+	size_t payload_offset;
+	ComputedMember* computed;
+	size_t num_computed;
+	size_t cache_offset;
+	ClassLaneRun* lane_runs;
+	size_t num_lane_runs;
+	ClassOperators operators;
+	uint32_t schema_version;
+	uint64_t schema_hash;
+	unsigned char* default_payload;
+	int cache_line_padded;
+	ClassStatCounters stats;
+} ClassType;
+
+#define CLASS_CACHE_LINE_SIZE 64
+
+// the payload is laid out like the equivalent C struct, every member at its native width and alignment.
+// it follows the header at the type's payload offset, so vector members stay aligned inside the instance.
+// dirty has one bit per member written through a setter since the last class_clear_dirty,
+// cached has one bit per computed member whose value in the payload is current
+typedef struct Class {
+	const ClassType* type;
+	uint64_t dirty;
+	uint64_t cached;
+} Class;
+
+static inline unsigned char* class_payload(const Class* klass)
+{
+	return (unsigned char*)klass + klass->type->payload_offset;
+}
+
+// members past the 63rd share the last bit of the dirty mask
+static inline uint64_t class_member_dirty_bit(size_t index)
+{
+	return index < 63 ? (uint64_t)1 << index : (uint64_t)1 << 63;
+}
+
+// every setter records the write here, it marks the member dirty and drops the computed values that read it
+static inline void class_member_written(Class* klass, size_t index)
+{
+	klass->dirty |= class_member_dirty_bit(index);
+	klass->cached &= ~klass->type->members[index].invalidates;
+}
+
+// unchecked accessors for loops that already validated the instance and index, each is a raw field load
+static inline size_t class_get_num_members_unchecked(const Class* klass)
+{
+	return klass->type->num_members;
+}
+
+static inline const Member* class_get_member_unchecked(const Class* klass, size_t index)
+{
+	return &klass->type->members[index];
+}
+
+static inline void* class_get_member_address_unchecked(const Class* klass, size_t index)
+{
+	return class_payload(klass) + klass->type->members[index].offset;
+}
+
+static inline MemberData class_get_member_data_unchecked(const Class* klass, size_t index)
+{
+	const Member* member = &klass->type->members[index];
+	return member_data_load(member->type, class_payload(klass) + member->offset);
+}
+
+static inline void class_set_member_data_unchecked(Class* klass, size_t index, MemberData data)
+{
+	const Member* member = &klass->type->members[index];
+	member_data_store(member->type, class_payload(klass) + member->offset, data);
+	class_member_written(klass, index);
+}
+
+// native-typed accessors for hot loops, one load or store at the member's offset with no tag switch.
+// the slot and member type are only checked when checking is enabled, the setters mark the member dirty
+static inline float class_get_f32(const Class* klass, size_t slot)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_F32, "member type mismatch!");
+	float value;
+	memcpy(&value, class_payload(klass) + klass->type->members[slot].offset, sizeof(value));
+	return value;
+}
+
+static inline double class_get_f64(const Class* klass, size_t slot)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_F64, "member type mismatch!");
+	double value;
+	memcpy(&value, class_payload(klass) + klass->type->members[slot].offset, sizeof(value));
+	return value;
+}
+
+static inline int32_t class_get_i32(const Class* klass, size_t slot)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_I32, "member type mismatch!");
+	int32_t value;
+	memcpy(&value, class_payload(klass) + klass->type->members[slot].offset, sizeof(value));
+	return value;
+}
+
+static inline uint32_t class_get_u32(const Class* klass, size_t slot)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_U32, "member type mismatch!");
+	uint32_t value;
+	memcpy(&value, class_payload(klass) + klass->type->members[slot].offset, sizeof(value));
+	return value;
+}
+
+static inline void class_set_f32(Class* klass, size_t slot, float value)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_F32, "member type mismatch!");
+	memcpy(class_payload(klass) + klass->type->members[slot].offset, &value, sizeof(value));
+	class_member_written(klass, slot);
+}
+
+static inline void class_set_f64(Class* klass, size_t slot, double value)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_F64, "member type mismatch!");
+	memcpy(class_payload(klass) + klass->type->members[slot].offset, &value, sizeof(value));
+	class_member_written(klass, slot);
+}
+
+static inline void class_set_i32(Class* klass, size_t slot, int32_t value)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_I32, "member type mismatch!");
+	memcpy(class_payload(klass) + klass->type->members[slot].offset, &value, sizeof(value));
+	class_member_written(klass, slot);
+}
+
+static inline void class_set_u32(Class* klass, size_t slot, uint32_t value)
+{
+	CLASS_ASSERT(slot < klass->type->num_members, "index out of bounds!");
+	CLASS_ASSERT(klass->type->members[slot].type == MEMBER_TYPE_U32, "member type mismatch!");
+	memcpy(class_payload(klass) + klass->type->members[slot].offset, &value, sizeof(value));
+	class_member_written(klass, slot);
+}
+
+typedef struct ClassCreateInfo {
+	const char* name;
+	const Function* ctor;
+	const Function* dtor;
+	const Member* members;
+	size_t num_members;
+	const Function* functions;
+	size_t num_functions;
+	const Allocator* allocator;
+	int cache_line_padded;
+	size_t payload_size;
+	const ClassType* base;
+	CopyMemberFn copy;
+} ClassCreateInfo;
+
+// declarative class definitions. members and methods are given as X-macro lists,
+//   #define VEC2_MEMBERS(MEMBER, C) MEMBER(C, f32, x) MEMBER(C, f32, y)
+//   #define VEC2_METHODS(METHOD, C) METHOD(C, add, vec2_add, vec2_add_into, vec2_add_batch)
+//   CLASS_DEFINE(Vec2, VEC2_MEMBERS, VEC2_METHODS, vec2_ctor, vec2_dtor)
+// emits the payload struct Vec2Data, slot constants Vec2_slot_add, and a static const
+// Vec2_create_info whose member offsets are taken from Vec2Data at compile time.
+// a class needs at least one member, ctor and dtor may be NULL and method forms may be NULL.
+// f32[] members have no fixed size and can only be added at runtime
+typedef struct Float2 { _Alignas(8) float v[2]; } Float2;
+typedef struct Float4 { _Alignas(16) float v[4]; } Float4;
+typedef struct Float8 { _Alignas(32) float v[8]; } Float8;
+
+#define CLASS_CTYPE_f32 float
+#define CLASS_CTYPE_f64 double
+#define CLASS_CTYPE_i32 int32_t
+#define CLASS_CTYPE_u32 uint32_t
+#define CLASS_CTYPE_f32x2 Float2
+#define CLASS_CTYPE_f32x4 Float4
+#define CLASS_CTYPE_f32x8 Float8
+
+#define CLASS_MEMBER_TYPE_f32 MEMBER_TYPE_F32
+#define CLASS_MEMBER_TYPE_f64 MEMBER_TYPE_F64
+#define CLASS_MEMBER_TYPE_i32 MEMBER_TYPE_I32
+#define CLASS_MEMBER_TYPE_u32 MEMBER_TYPE_U32
+#define CLASS_MEMBER_TYPE_f32x2 MEMBER_TYPE_F32X2
+#define CLASS_MEMBER_TYPE_f32x4 MEMBER_TYPE_F32X4
+#define CLASS_MEMBER_TYPE_f32x8 MEMBER_TYPE_F32X8
+
+#define CLASS_X_FIELD(C, kind, field) CLASS_CTYPE_##kind field;
+#define CLASS_X_MEMBER(C, kind, field) { .name = #field, .type = CLASS_MEMBER_TYPE_##kind, .offset = (uint32_t)offsetof(C##Data, field) },
+#define CLASS_X_SLOT(C, method, binary, binary_into, batch) C##_slot_##method,
+#define CLASS_X_METHOD(C, method, binary, binary_into, batch) { .name = #method, .type = FUNCTION_TYPE_MEMBER_FUNCTION, .binary_member_fn = binary, .binary_member_into_fn = binary_into, .batch_fn = batch },
+
+// a type used from several translation units puts CLASS_DECLARE in its header, which emits the payload
+// struct and slot constants, and CLASS_DEFINE_INFO in the one source file that creates the type
+#define CLASS_DECLARE(C, MEMBERS, METHODS) \
+	typedef struct C##Data { MEMBERS(CLASS_X_FIELD, C) } C##Data; \
+	enum C##Slot { METHODS(CLASS_X_SLOT, C) C##_slot_count };
+
+#define CLASS_DEFINE(C, MEMBERS, METHODS, ctor_fn, dtor_fn) \
+	CLASS_DECLARE(C, MEMBERS, METHODS) \
+	CLASS_DEFINE_INFO(C, MEMBERS, METHODS, ctor_fn, dtor_fn)
+
+#define CLASS_DEFINE_INFO(C, MEMBERS, METHODS, ctor_fn, dtor_fn) \
+	static const Member C##_members[] = { MEMBERS(CLASS_X_MEMBER, C) { .name = NULL } }; \
+	static const Function C##_functions[] = { METHODS(CLASS_X_METHOD, C) { .name = NULL } }; \
+	static const Function C##_ctor = { .name = #ctor_fn, .type = FUNCTION_TYPE_CONSTRUCTOR, .fn = ctor_fn }; \
+	static const Function C##_dtor = { .name = #dtor_fn, .type = FUNCTION_TYPE_DESTRUCTOR, .fn = dtor_fn }; \
+	static const ClassCreateInfo C##_create_info = { \
+		.name = #C, \
+		.ctor = &C##_ctor, \
+		.dtor = &C##_dtor, \
+		.members = C##_members, \
+		.num_members = sizeof(C##_members) / sizeof(Member) - 1, \
+		.functions = C##_functions, \
+		.num_functions = sizeof(C##_functions) / sizeof(Function) - 1, \
+		.payload_size = sizeof(C##Data) \
+	};
+
+// derived classes embed the base payload struct first, set createInfo.base to the base type before creating it.
+// new methods are appended after the base slots and methods named like a base method override it in place
+#define CLASS_DEFINE_DERIVED(C, B, MEMBERS, METHODS, ctor_fn, dtor_fn) \
+	typedef struct C##Data { B##Data base; MEMBERS(CLASS_X_FIELD, C) } C##Data; \
+	CLASS_DEFINE_INFO(C, MEMBERS, METHODS, ctor_fn, dtor_fn)
+
+// typed view of an instance payload, offsets fold to constants
+#define CLASS_DATA(C, klass) ((C##Data*)class_get_payload(klass))
+
+C_CLASS_API ClassType* class_type_create(const ClassCreateInfo* createInfo);
+C_CLASS_API void class_type_destroy(ClassType* type);
+C_CLASS_API const char* class_type_get_name(const ClassType* type);
+C_CLASS_API NameAtom class_type_get_atom(const ClassType* type);
+C_CLASS_API size_t class_type_get_instance_size(const ClassType* type);
+C_CLASS_API size_t class_type_get_instance_alignment(const ClassType* type);
+C_CLASS_API size_t class_type_get_payload_size(const ClassType* type);
+C_CLASS_API ClassStats class_type_get_stats(const ClassType* type);
+C_CLASS_API const Allocator* class_type_get_allocator(const ClassType* type);
+C_CLASS_API void class_type_set_allocator(ClassType* type, const Allocator* allocator);
+C_CLASS_API void class_type_set_copy_fn(ClassType* type, CopyMemberFn copy);
+C_CLASS_API int class_type_reserve(ClassType* type, size_t member_capacity, size_t function_capacity);
+C_CLASS_API int class_type_add_member(ClassType* type, Member* member);
+C_CLASS_API int class_type_add_members(ClassType* type, const Member* members, size_t count);
+C_CLASS_API int class_type_add_function(ClassType* type, Function* function);
+C_CLASS_API int class_type_add_functions(ClassType* type, const Function* functions, size_t count);
+C_CLASS_API Member* class_type_get_member(const ClassType* type, size_t index);
+C_CLASS_API Function* class_type_get_function(const ClassType* type, size_t index);
+C_CLASS_API size_t class_type_find_member_slot(const ClassType* type, const char* name);
+C_CLASS_API size_t class_type_find_function_slot(const ClassType* type, const char* name);
+C_CLASS_API size_t class_type_find_member_slot_atom(const ClassType* type, NameAtom atom);
+C_CLASS_API size_t class_type_find_function_slot_atom(const ClassType* type, NameAtom atom);
+C_CLASS_API UnaryMemberFn class_type_get_unary_fn(const ClassType* type, size_t slot);
+C_CLASS_API BinaryMemberFn class_type_get_binary_fn(const ClassType* type, size_t slot);
+C_CLASS_API BinaryMemberIntoFn class_type_get_binary_into_fn(const ClassType* type, size_t slot);
+C_CLASS_API size_t class_type_get_num_members(const ClassType* type);
+C_CLASS_API size_t class_type_get_num_functions(const ClassType* type);
+C_CLASS_API const ClassType* class_type_get_base(const ClassType* type);
+C_CLASS_API int class_type_is_a(const ClassType* type, const ClassType* base);
+C_CLASS_API size_t class_type_add_computed_member(ClassType* type, const char* name, MemberType member_type, ComputedMemberFn fn, const size_t* dependencies, size_t num_dependencies);
+C_CLASS_API size_t class_type_get_num_computed_members(const ClassType* type);
+C_CLASS_API const ComputedMember* class_type_get_computed_member(const ClassType* type, size_t index);
+C_CLASS_API size_t class_type_find_computed_slot(const ClassType* type, const char* name);
+C_CLASS_API const ClassOperators* class_type_get_operators(const ClassType* type);
+C_CLASS_API int class_type_add_operator_functions(ClassType* type);
+C_CLASS_API uint64_t class_type_get_schema_hash(const ClassType* type);
+C_CLASS_API uint32_t class_type_get_schema_version(const ClassType* type);
+C_CLASS_API void class_type_set_schema_version(ClassType* type, uint32_t version);
+
+// unchecked in release builds, the vtable entry is a single indexed load
+static inline const Function* class_type_vtable_entry(const ClassType* type, size_t slot)
+{
+	CLASS_ASSERT(type != NULL, "invalid class type!");
+	CLASS_ASSERT(slot < type->num_functions, "index out of bounds!");
+	return &type->functions[slot];
+}
+
+// static dispatch through the vtable, skipping function_invoke and its type switch
+#define CLASS_CALL(klass, other, slot) (class_type_vtable_entry((klass)->type, (slot))->binary_member_fn((klass), (other)))
+#define CLASS_CALL_INTO(out, klass, other, slot) (class_type_vtable_entry((klass)->type, (slot))->binary_member_into_fn((out), (klass), (other)))
+
+C_CLASS_API Class* class_create(const ClassType* type);
+C_CLASS_API Class* class_create_with_allocator(const ClassType* type, const Allocator* allocator);
+C_CLASS_API Class* class_create_in_place(const ClassType* type, void* memory);
+// every destroy and release function accepts NULL and does nothing, like free
+C_CLASS_API void class_destroy(Class* klass);
+C_CLASS_API void class_destroy_with_allocator(Class* klass, const Allocator* allocator);
+C_CLASS_API void class_destroy_in_place(Class* klass);
+C_CLASS_API Class* class_clone(const Class* klass);
+C_CLASS_API Class* class_clone_with_allocator(const Class* klass, const Allocator* allocator);
+C_CLASS_API Class* class_clone_in_place(const Class* klass, void* memory);
+C_CLASS_API const ClassType* class_get_type(const Class* klass);
+C_CLASS_API const char* class_get_name(const Class* klass);
+C_CLASS_API int class_has_constructor(const Class* klass);
+C_CLASS_API int class_has_destructor(const Class* klass);
+C_CLASS_API const Function* class_get_constructor(const Class* klass);
+C_CLASS_API const Function* class_get_destructor(const Class* klass);
+C_CLASS_API Class* class_invoke_function(const Class* klass, const Class* other, size_t index);
+C_CLASS_API void class_invoke_function_into(Class* out, const Class* klass, const Class* other, size_t index);
+C_CLASS_API const Member* class_get_member(const Class* klass, size_t index);
+C_CLASS_API MemberData class_get_member_data(const Class* klass, size_t index);
+C_CLASS_API void* class_get_member_address(const Class* klass, size_t index);
+C_CLASS_API void class_set_member_data(Class* klass, size_t index, MemberData data);
+C_CLASS_API void class_set_member_f32(Class* klass, size_t index, float value);
+C_CLASS_API void class_set_member_f64(Class* klass, size_t index, double value);
+C_CLASS_API void class_set_member_i32(Class* klass, size_t index, int32_t value);
+C_CLASS_API void class_set_member_u32(Class* klass, size_t index, uint32_t value);
+C_CLASS_API void class_mark_member_dirty(Class* klass, size_t index);
+C_CLASS_API int class_is_member_dirty(const Class* klass, size_t index);
+C_CLASS_API uint64_t class_get_dirty_mask(const Class* klass);
+C_CLASS_API void class_clear_dirty(Class* klass);
+C_CLASS_API const void* class_get_computed(const Class* klass, size_t slot);
+C_CLASS_API MemberData class_get_computed_data(const Class* klass, size_t slot);
+C_CLASS_API int class_is_computed_cached(const Class* klass, size_t slot);
+C_CLASS_API void class_invalidate_computed(Class* klass);
+C_CLASS_API void* class_get_payload(const Class* klass);
+C_CLASS_API const Function* class_get_function(const Class* klass, size_t index);
+C_CLASS_API const Member* class_find_member(const Class* klass, const char* name);
+C_CLASS_API const Function* class_find_function(const Class* klass, const char* name);
+C_CLASS_API size_t class_get_num_members(const Class* klass);
+C_CLASS_API size_t class_get_num_functions(const Class* klass);
+C_CLASS_API void class_debug_print(const Class* klass);
+
+typedef enum ClassFormat {
+	CLASS_FORMAT_TEXT,
+	CLASS_FORMAT_JSON,
+	CLASS_FORMAT_CSV,
+} ClassFormat;
+
+typedef void (*ClassWriterSink) (void* user_data, const char* data, size_t length);
+
+// buffered output, the sink only sees full buffers and the final flush.
+// without a sink output that does not fit is dropped and overflowed is set
+typedef struct ClassWriter {
+	char* buffer;
+	size_t capacity;
+	size_t length;
+	ClassWriterSink sink;
+	void* user_data;
+	ClassFormat format;
+	int overflowed;
+} ClassWriter;
+
+C_CLASS_API void class_writer_init(ClassWriter* writer, char* buffer, size_t capacity, ClassFormat format, ClassWriterSink sink, void* user_data);
+C_CLASS_API void class_writer_flush(ClassWriter* writer);
+C_CLASS_API void class_writer_write(ClassWriter* writer, const char* data, size_t length);
+C_CLASS_API void class_writer_write_char(ClassWriter* writer, char c);
+C_CLASS_API void class_writer_write_string(ClassWriter* writer, const char* string);
+C_CLASS_API void class_writer_write_u64(ClassWriter* writer, uint64_t value);
+C_CLASS_API void class_writer_write_i64(ClassWriter* writer, int64_t value);
+C_CLASS_API void class_writer_write_f64(ClassWriter* writer, double value);
+C_CLASS_API void class_writer_write_member_data(ClassWriter* writer, MemberType type, MemberData data);
+C_CLASS_API void class_writer_file_sink(void* user_data, const char* data, size_t length);
+C_CLASS_API void class_write(ClassWriter* writer, const Class* klass);
+C_CLASS_API void class_write_batch(ClassWriter* writer, const Class* const* instances, size_t count);
+
+// copy-on-write handles share one refcounted instance until a handle asks for write access
+typedef struct ClassCowBlock {
+	atomic_size_t references;
+	size_t instance_offset;
+} ClassCowBlock;
+
+typedef struct ClassCow {
+	ClassCowBlock* block;
+} ClassCow;
+
+C_CLASS_API ClassCow class_cow_create(const Class* klass);
+C_CLASS_API ClassCow class_cow_clone(ClassCow cow);
+C_CLASS_API const Class* class_cow_read(ClassCow cow);
+C_CLASS_API Class* class_cow_write(ClassCow* cow);
+C_CLASS_API void class_cow_release(ClassCow* cow);
+C_CLASS_API int class_cow_is_shared(ClassCow cow);
+
+#define CLASS_ARCHIVE_MAGIC 0x534C4343u
+#define CLASS_ARCHIVE_VERSION 4u
+
+// file layout, all fields in native byte order:
+//   u32 magic, u32 version, u32 schema_version, u64 schema_hash,
+//   u32 payload_size, u32 num_members, u64 count,
+//   u32 stride, u32 payload_offset, u32 alignment, u32 records_offset,
+//   u32 name_length, name bytes,
+//   per member: u32 type, u32 offset, u32 count, u32 name_length, name bytes,
+//   zero padding up to records_offset, a multiple of alignment,
+//   count records of stride bytes, each a zeroed instance header followed by the payload.
+// records are laid out like instances, so a mapping of the file is used in place by class_archive_map.
+// version 2 archives have no schema fields, version 2 and 3 archives store packed payloads without
+// headers and the fields from stride on, both are still read.
+// an archive whose schema differs from the type is migrated while it is read, stored members are matched
+// to the type's members by name, converted lane by lane and members the archive lacks get their defaults
+typedef struct ClassArchive {
+	const ClassType* type;
+	unsigned char* records;
+	size_t count;
+	size_t stride;
+	int in_place;
+	uint32_t schema_version;
+	uint64_t schema_hash;
+	int migrated;
+} ClassArchive;
+
+C_CLASS_API int class_archive_write(FILE* file, const ClassType* type, const Class* const* instances, size_t count);
+C_CLASS_API ClassArchive* class_archive_read(FILE* file, const ClassType* type);
+C_CLASS_API ClassArchive* class_archive_read_memory(const void* data, size_t size, const ClassType* type);
+C_CLASS_API ClassArchive* class_archive_map(void* data, size_t size, const ClassType* type);
+C_CLASS_API int class_archive_is_in_place(const ClassArchive* archive);
+C_CLASS_API uint32_t class_archive_get_schema_version(const ClassArchive* archive);
+C_CLASS_API uint64_t class_archive_get_schema_hash(const ClassArchive* archive);
+C_CLASS_API int class_archive_is_migrated(const ClassArchive* archive);
+C_CLASS_API void class_archive_destroy(ClassArchive* archive);
+C_CLASS_API size_t class_archive_get_count(const ClassArchive* archive);
+C_CLASS_API Class* class_archive_get_instance(const ClassArchive* archive, size_t index);
+
+#define CLASS_REGISTRY_CAPACITY 256
+#define CLASS_THREAD_CACHE_SIZE 64
+
+C_CLASS_API int class_registry_register(ClassType* type);
+C_CLASS_API const ClassType* class_registry_find(const char* name);
+C_CLASS_API const ClassType* class_registry_get(size_t id);
+C_CLASS_API size_t class_registry_get_count(void);
+C_CLASS_API void class_registry_flush_thread_cache(void);
+C_CLASS_API void class_registry_shutdown(void);
+
+// structure-of-arrays storage, every member of the type is kept in its own contiguous native-typed column.
+// rows written through the row setters get a dirty mask like an instance and are listed once in dirty_rows
+typedef struct ClassBatch {
+	const ClassType* type;
+	void** columns;
+	size_t count;
+	size_t capacity;
+	uint64_t* dirty_masks;
+	size_t* dirty_rows;
+	atomic_size_t num_dirty;
+} ClassBatch;
+
+typedef struct ClassBatchRow {
+	ClassBatch* batch;
+	size_t row;
+} ClassBatchRow;
+
+C_CLASS_API ClassBatch* class_batch_create(const ClassType* type, size_t capacity);
+C_CLASS_API void class_batch_destroy(ClassBatch* batch);
+C_CLASS_API int class_batch_reserve(ClassBatch* batch, size_t capacity);
+C_CLASS_API size_t class_batch_push(ClassBatch* batch);
+C_CLASS_API size_t class_batch_push_instance(ClassBatch* batch, const Class* klass);
+C_CLASS_API void class_batch_clear(ClassBatch* batch);
+C_CLASS_API const ClassType* class_batch_get_type(const ClassBatch* batch);
+C_CLASS_API size_t class_batch_get_count(const ClassBatch* batch);
+C_CLASS_API void* class_batch_get_column(const ClassBatch* batch, size_t index);
+C_CLASS_API ClassBatchRow class_batch_get_row(ClassBatch* batch, size_t row);
+C_CLASS_API const Member* class_batch_row_get_member(ClassBatchRow row, size_t index);
+C_CLASS_API void* class_batch_row_get_member_address(ClassBatchRow row, size_t index);
+C_CLASS_API MemberData class_batch_row_get_member_data(ClassBatchRow row, size_t index);
+C_CLASS_API void class_batch_row_set_member_data(ClassBatchRow row, size_t index, MemberData data);
+C_CLASS_API void class_batch_row_mark_dirty(ClassBatchRow row, size_t index);
+C_CLASS_API uint64_t class_batch_row_get_dirty_mask(ClassBatchRow row);
+C_CLASS_API size_t class_batch_get_num_dirty(const ClassBatch* batch);
+C_CLASS_API size_t class_batch_get_dirty_row(const ClassBatch* batch, size_t index);
+C_CLASS_API void class_batch_clear_dirty(ClassBatch* batch);
+C_CLASS_API void class_batch_row_load(ClassBatchRow row, Class* out);
+C_CLASS_API void class_batch_row_store(ClassBatchRow row, const Class* klass);
+C_CLASS_API void class_batch_invoke(const Function* function, ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count);
+
+
+// slot map of instances of one type. instances are kept densely packed and move when another one is destroyed,
+// so other code holds a handle instead of the Class*. a handle is a slot index plus the slot's generation,
+// destroying an instance bumps the generation and every older handle to it stops resolving.
+// a store holds at most CLASS_HANDLE_INDEX_MASK instances, a slot whose generation would wrap
+// is retired instead of reused so a stale handle can never resolve to a later instance
+typedef uint32_t ClassHandle;
+
+#define CLASS_HANDLE_NONE 0u
+#define CLASS_HANDLE_INDEX_BITS 20
+#define CLASS_HANDLE_INDEX_MASK ((1u << CLASS_HANDLE_INDEX_BITS) - 1u)
+#define CLASS_HANDLE_GENERATION_MASK ((1u << (32 - CLASS_HANDLE_INDEX_BITS)) - 1u)
+
+typedef struct ClassStore {
+	const ClassType* type;
+	unsigned char* instances;
+	uint32_t* dense_slots;
+	uint32_t* slots;
+	uint32_t* generations;
+	size_t stride;
+	size_t count;
+	size_t capacity;
+	size_t num_slots;
+	size_t slot_capacity;
+	uint32_t free_slot;
+} ClassStore;
+
+C_CLASS_API ClassStore* class_store_create(const ClassType* type, size_t capacity);
+C_CLASS_API void class_store_destroy(ClassStore* store);
+C_CLASS_API int class_store_reserve(ClassStore* store, size_t capacity);
+C_CLASS_API ClassHandle class_store_add(ClassStore* store);
+C_CLASS_API ClassHandle class_store_add_clone(ClassStore* store, const Class* klass);
+C_CLASS_API void class_store_remove(ClassStore* store, ClassHandle handle);
+C_CLASS_API int class_store_is_valid(const ClassStore* store, ClassHandle handle);
+C_CLASS_API Class* class_store_get(const ClassStore* store, ClassHandle handle);
+C_CLASS_API size_t class_store_get_count(const ClassStore* store);
+C_CLASS_API Class* class_store_get_instance(const ClassStore* store, size_t index);
+C_CLASS_API ClassHandle class_store_get_handle(const ClassStore* store, size_t index);
+
+
+// destruction deferred to a sync point. latency sensitive threads only queue instances,
+// flush later runs the destructors grouped by type and then releases all the memory in one pass
+typedef struct ClassDeferredDestroy {
+	Class* klass;
+	const Allocator* allocator;
+} ClassDeferredDestroy;
+
+typedef struct ClassDestroyQueue {
+	mtx_t lock;
+	mtx_t flush_lock;
+	ClassDeferredDestroy* entries;
+	size_t count;
+	size_t capacity;
+	ClassDeferredDestroy* flushing;
+	size_t flushing_capacity;
+} ClassDestroyQueue;
+
+C_CLASS_API ClassDestroyQueue* class_destroy_queue_create(size_t capacity);
+C_CLASS_API void class_destroy_queue_destroy(ClassDestroyQueue* queue);
+C_CLASS_API void class_destroy_deferred(ClassDestroyQueue* queue, Class* klass);
+C_CLASS_API void class_destroy_deferred_with_allocator(ClassDestroyQueue* queue, Class* klass, const Allocator* allocator);
+C_CLASS_API size_t class_destroy_queue_flush(ClassDestroyQueue* queue);
+C_CLASS_API size_t class_destroy_queue_get_pending(ClassDestroyQueue* queue);
+
+
+// work-stealing pool for data parallel passes. a run splits [0, count) evenly over the workers,
+// each worker takes grain sized chunks from the front of its own range and an idle worker
+// steals the back half of another worker's range. the calling thread is worker 0
+typedef void (*ClassParallelFn) (void* user_data, size_t begin, size_t end, size_t worker);
+
+typedef struct ClassWorkRange {
+	struct ClassThreadPool* pool;
+	mtx_t lock;
+	size_t begin;
+	size_t end;
+} ClassWorkRange;
+
+typedef struct ClassThreadPool {
+	thrd_t* threads;
+	ClassWorkRange* ranges;
+	size_t num_workers;
+	mtx_t run_lock;
+	mtx_t lock;
+	cnd_t wake;
+	cnd_t done;
+	size_t generation;
+	size_t active;
+	int shutdown;
+	ClassParallelFn fn;
+	void* user_data;
+	size_t grain;
+} ClassThreadPool;
+
+#define CLASS_PARALLEL_DEFAULT_GRAIN 1024
+
+C_CLASS_API ClassThreadPool* class_thread_pool_create(size_t num_workers);
+C_CLASS_API void class_thread_pool_destroy(ClassThreadPool* pool);
+C_CLASS_API void class_thread_pool_run(ClassThreadPool* pool, size_t count, size_t grain, ClassParallelFn fn, void* user_data);
+C_CLASS_API size_t class_thread_pool_get_num_workers(const ClassThreadPool* pool);
+C_CLASS_API ClassThreadPool* class_thread_pool_get_default(void);
+C_CLASS_API void class_thread_pool_shutdown_default(void);
+
+// run a member function over every row or instance on the default pool, grain 0 picks CLASS_PARALLEL_DEFAULT_GRAIN
+C_CLASS_API void class_batch_parallel_for(ClassBatch* batch, const Function* function, size_t grain);
+C_CLASS_API void class_batch_parallel_invoke(const Function* function, ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count, size_t grain);
+C_CLASS_API void class_store_parallel_for(ClassStore* store, const Function* function, size_t grain);
+
+
+// element-wise arithmetic over the lane runs of a type, all operands and out share one type
+C_CLASS_API void class_add_into(Class* out, const Class* lhs, const Class* rhs);
+C_CLASS_API void class_sub_into(Class* out, const Class* lhs, const Class* rhs);
+C_CLASS_API void class_mul_into(Class* out, const Class* lhs, const Class* rhs);
+C_CLASS_API void class_scale_into(Class* out, const Class* klass, double scalar);
+C_CLASS_API double class_dot(const Class* lhs, const Class* rhs);
+
+// fused element-wise expressions. operands and operators are pushed in postfix order,
+//   class_expr_push(&expr, a); class_expr_push(&expr, b); class_expr_scale(&expr, s); class_expr_add(&expr);
+// builds a + b * s, and class_expr_eval_into makes one pass over the operands with no temporary instances.
+// float lanes are evaluated in double in small chunks and rounded once when they are stored,
+// integer lanes follow the ClassOperators rules node by node
+typedef enum ClassExprOp {
+	CLASS_EXPR_PUSH,
+	CLASS_EXPR_ADD,
+	CLASS_EXPR_SUB,
+	CLASS_EXPR_MUL,
+	CLASS_EXPR_SCALE,
+} ClassExprOp;
+
+typedef struct ClassExprNode {
+	ClassExprOp op;
+	const Class* operand;
+	double scalar;
+} ClassExprNode;
+
+#define CLASS_EXPR_MAX_NODES 32
+#define CLASS_EXPR_MAX_DEPTH 8
+#define CLASS_EXPR_CHUNK 32
+
+typedef struct ClassExpr {
+	const ClassType* type;
+	ClassExprNode nodes[CLASS_EXPR_MAX_NODES];
+	size_t num_nodes;
+	size_t depth;
+	int valid;
+} ClassExpr;
+
+C_CLASS_API void class_expr_init(ClassExpr* expr);
+C_CLASS_API void class_expr_push(ClassExpr* expr, const Class* operand);
+C_CLASS_API void class_expr_add(ClassExpr* expr);
+C_CLASS_API void class_expr_sub(ClassExpr* expr);
+C_CLASS_API void class_expr_mul(ClassExpr* expr);
+C_CLASS_API void class_expr_scale(ClassExpr* expr, double scalar);
+C_CLASS_API int class_expr_eval_into(const ClassExpr* expr, Class* out);
+
+// call tracing. while enabled, every ctor, dtor and member function run through function_invoke
+// or function_invoke_into and every batch kernel run by class_batch_invoke is recorded with its type,
+// thread and begin and end time. each thread writes its own ring buffer without locking and
+// overwrites its oldest events once CLASS_TRACE_BUFFER_CAPACITY are pending.
+// the export is the chrome trace event format, which perfetto and chrome://tracing load.
+// the static dispatch macros bypass function_invoke and are not traced
+#define CLASS_TRACE_BUFFER_CAPACITY 8192
+
+C_CLASS_API void class_trace_set_enabled(int enabled);
+C_CLASS_API int class_trace_is_enabled(void);
+C_CLASS_API size_t class_trace_get_num_events(void);
+C_CLASS_API void class_trace_clear(void);
+C_CLASS_API int class_trace_export_chrome(FILE* file);
+C_CLASS_API void class_trace_shutdown(void);
+
+// nanoseconds on the monotonic clock events are stamped with, benchmarks time themselves with it too
+C_CLASS_API uint64_t class_trace_now(void);
+
+#endif
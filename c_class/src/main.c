@@ -1,600 +1,1094 @@
-#include "stdio.h"
-#include "stdint.h"
-#include "stdlib.h"
+#include "c_class.h"
+#include "vec2.h"
+#include "threads.h"
+#include "math.h"
+
+static int s_failed_checks = 0;
+
+// a failed check is reported and counted, the run keeps going so it lists every failure
+#define TEST_CHECK(condition) \
+	do { if (!(condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); s_failed_checks++; } } while (0)
+
+// collects writer and trace output so tests can look at it
+typedef struct TestText {
+	char data[4096];
+	size_t length;
+} TestText;
+
+static void test_text_sink(void* user_data, const char* data, size_t length) {
+	TestText* text = (TestText*)user_data;
+	const size_t space = sizeof(text->data) - 1 - text->length;
+	const size_t count = length < space ? length : space;
+	memcpy(text->data + text->length, data, count);
+	text->length += count;
+	text->data[text->length] = '\0';
+}
 
-#define DEBUG_BREAK(msg) __debugbreak();
-#define STRINGIFY(s) #s
+static void test_text_read_file(TestText* text, FILE* file) {
+	rewind(file);
+	text->length = fread(text->data, 1, sizeof(text->data) - 1, file);
+	text->data[text->length] = '\0';
+}
 
-typedef enum MemberType {
-	MEMBER_TYPE_F32,
-	MEMBER_TYPE_F64,
-	MEMBER_TYPE_I32,
-	MEMBER_TYPE_U32,
-} MemberType;
+// nothing of the type may outlive a test
+static void test_check_no_live_instances(const ClassType* type) {
+#if CLASS_ENABLE_STATS
+	const ClassStats stats = class_type_get_stats(type);
+	TEST_CHECK(stats.live_instances == 0);
+	TEST_CHECK(stats.bytes_in_use == 0);
+#endif
+}
 
-const char* member_type_to_string(MemberType type);
+void test_class_test(void) {
+	// failure paths destroy whatever they got back without checking it first
+	class_destroy(NULL);
+	class_destroy_in_place(NULL);
+	class_type_destroy(NULL);
 
-const char* member_type_to_string(MemberType type)
-{
-	switch (type) {
-		case MEMBER_TYPE_F32: return "f32";
-		case MEMBER_TYPE_F64: return "f64";
-		case MEMBER_TYPE_I32: return "i32";
-		case MEMBER_TYPE_U32: return "u32";
-	}
+	ClassCreateInfo createInfo = { .name = "TestClass" };
+	ClassType* type = class_type_create(&createInfo);
+	if (type == NULL)
+		return;
 
-	DEBUG_BREAK("unknown member type!");
-	return "";
+	Class* klass = class_create(type);
+	TEST_CHECK(klass != NULL);
+	if (klass == NULL) {
+		class_type_destroy(type);
+		return;
+	}
+	
+	TEST_CHECK(class_get_type(klass) == type);
+	class_debug_print(klass);
+	class_destroy(klass);
+	class_type_destroy(type);
 }
 
-typedef union MemberData {
-	float f_data;
-	double d_data;
-	int32_t i_data;
-	uint32_t u_data;
-} MemberData;
+void vec3_add_into(Class* out, const Class* lhs, const Class* rhs);
 
-typedef struct Member {
-	MemberData data;
-	char* name;
-	MemberType type;
-} Member;
+#define VEC3_MEMBERS(MEMBER, C) \
+	MEMBER(C, f32, z)
 
-const char* member_get_name(const Member* member);
-MemberType member_get_type(const Member* member);
-MemberData member_get_data(const Member* member);
+#define VEC3_METHODS(METHOD, C) \
+	METHOD(C, add, NULL, vec3_add_into, NULL)
 
-const char* member_get_name(const Member* member)
-{
-	if (member == NULL) {
-		return NULL;
-	}
+CLASS_DEFINE_DERIVED(Vec3, Vec2, VEC3_MEMBERS, VEC3_METHODS, NULL, NULL)
 
-	return member->name;
+void vec3_add_into(Class* out, const Class* lhs, const Class* rhs) {
+	vec2_add_into(out, lhs, rhs);
+	CLASS_DATA(Vec3, out)->z = CLASS_DATA(Vec3, lhs)->z + CLASS_DATA(Vec3, rhs)->z;
 }
 
-MemberType member_get_type(const Member* member)
-{
-	if (member == NULL) {
-		return MEMBER_TYPE_I32;
-	}
+void test_vec3_inheritance(void) {
+	ClassCreateInfo createInfo = Vec3_create_info;
+	createInfo.base = vec2_get_type();
+	ClassType* type = class_type_create(&createInfo);
+	if (type == NULL)
+		return;
 
-	return member->type;
+	Class* a = class_create(type);
+	Class* b = class_create(type);
+	*CLASS_DATA(Vec3, a) = (Vec3Data){ { 1, 2 }, 3 };
+	*CLASS_DATA(Vec3, b) = (Vec3Data){ { 4, 5 }, 6 };
+
+	// add keeps the Vec2 slot and dispatches to the Vec3 override
+	CLASS_CALL_INTO(a, a, b, Vec2_slot_add);
+	TEST_CHECK(CLASS_DATA(Vec3, a)->base.x == 5 && CLASS_DATA(Vec3, a)->base.y == 7 && CLASS_DATA(Vec3, a)->z == 9);
+	TEST_CHECK(class_type_is_a(type, vec2_get_type()) == 1);
+	TEST_CHECK(class_type_is_a(vec2_get_type(), type) == 0);
+
+	// adding a function named like an inherited one overrides it in place instead of appending a duplicate
+	const size_t num_functions = class_type_get_num_functions(type);
+	Function add_override = { .name = "add", .type = FUNCTION_TYPE_MEMBER_FUNCTION, .binary_member_into_fn = vec3_add_into };
+	TEST_CHECK(class_type_add_function(type, &add_override) == 1);
+	TEST_CHECK(class_type_get_num_functions(type) == num_functions);
+	TEST_CHECK(class_type_find_function_slot(type, "add") == Vec2_slot_add);
+
+	// the override only has the in-place form, the allocating call creates the result and fills it
+	Class* sum = class_invoke_function(a, b, Vec2_slot_add);
+	TEST_CHECK(sum != NULL && class_get_type(sum) == type);
+	TEST_CHECK(sum != NULL && CLASS_DATA(Vec3, sum)->base.x == 9 && CLASS_DATA(Vec3, sum)->base.y == 12 && CLASS_DATA(Vec3, sum)->z == 15);
+	class_destroy(sum);
+
+	class_destroy(a);
+	class_destroy(b);
+
+	// Vec3 has no constructor of its own, the Vec2 ones are counted
+#if CLASS_ENABLE_STATS
+	const ClassStats stats = class_type_get_stats(type);
+	TEST_CHECK(stats.ctor_calls == 3 && stats.dtor_calls == 3);
+#endif
+	class_type_destroy(type);
+	vec2_destroy_type();
 }
 
-MemberData member_get_data(const Member* member)
-{
-	if (member == NULL) {
-		DEBUG_BREAK("member was null!");
+void test_vec2_class(void) {
+	Class* a = create_vec2(1, 3);
+	Class* b = create_vec2(2, 4);
+	Class* c = class_invoke_function(a, b, Vec2_slot_add);
+	TEST_CHECK(class_get_f32(c, 0) == 3 && class_get_f32(c, 1) == 7);
+
+	// accumulate into an existing instance, no temporaries are created
+	class_invoke_function_into(c, c, b, Vec2_slot_add);
+	TEST_CHECK(class_get_f32(c, 0) == 5 && class_get_f32(c, 1) == 11);
+
+	// resolved dispatch, no lookup or type switch per call
+	const BinaryMemberIntoFn add_into = class_type_get_binary_into_fn(class_get_type(a), Vec2_slot_add);
+	add_into(c, a, b);
+	TEST_CHECK(class_get_f32(c, 0) == 3 && class_get_f32(c, 1) == 7);
+	CLASS_CALL_INTO(c, c, b, Vec2_slot_add);
+	TEST_CHECK(class_get_f32(c, 0) == 5 && class_get_f32(c, 1) == 11);
+
+	// resolve names once, then access by slot
+	const size_t y_slot = class_type_find_member_slot(class_get_type(c), "y");
+	const Function* add_fn = class_find_function(c, "add");
+	TEST_CHECK(y_slot == 1);
+	TEST_CHECK(add_fn != NULL && strcmp(function_get_name(add_fn), "add") == 0);
+	TEST_CHECK(class_type_find_member_slot(class_get_type(c), "w") == CLASS_INVALID_SLOT);
+
+	// interned names compare as integers, the same atom finds the member in any type that declares it
+	const NameAtom x_atom = name_intern("x");
+	TEST_CHECK(class_type_find_member_slot_atom(class_get_type(c), x_atom) == 0);
+	TEST_CHECK(class_type_get_atom(class_get_type(c)) == name_lookup("Vec2"));
+
+	Class* classes[] = { a, b, c };
+	const size_t num_classes = sizeof(classes) / sizeof(classes[0]);
+
+	// snapshots share the payload until one of them is written
+	ClassCow snapshot = class_cow_create(a);
+	ClassCow copy = class_cow_clone(snapshot);
+	TEST_CHECK(class_cow_is_shared(copy) == 1);
+	class_set_member_data(class_cow_write(&copy), 0, (MemberData){ .f_data = 42.0f });
+	TEST_CHECK(class_cow_is_shared(copy) == 0);
+	TEST_CHECK(class_get_member_data(class_cow_read(snapshot), 0).f_data == 1);
+	TEST_CHECK(class_get_member_data(class_cow_read(copy), 0).f_data == 42);
+	class_cow_release(&snapshot);
+	class_cow_release(&copy);
+
+	Class* clone = class_clone(b);
+	TEST_CHECK(clone != NULL && clone != b && class_get_f32(clone, 0) == 2 && class_get_f32(clone, 1) == 4);
+	class_destroy(clone);
+
+	// machine readable dumps, one flush per batch
+	char buffer[256];
+	TestText json = { .length = 0 };
+	ClassWriter writer;
+	class_writer_init(&writer, buffer, sizeof(buffer), CLASS_FORMAT_JSON, test_text_sink, &json);
+	class_write_batch(&writer, (const Class* const*)classes, num_classes);
+	TEST_CHECK(json.data[0] == '[' && strstr(json.data, "\"x\"") != NULL && strstr(json.data, "11") != NULL);
+
+	TestText csv = { .length = 0 };
+	class_writer_init(&writer, buffer, sizeof(buffer), CLASS_FORMAT_CSV, test_text_sink, &csv);
+	class_write_batch(&writer, (const Class* const*)classes, num_classes);
+	TEST_CHECK(strncmp(csv.data, "x,y\n", 4) == 0);
+
+	for (size_t i = 0; i < num_classes; i++) {
+		Class* klass = classes[i];
+		class_destroy(klass);
 	}
 
-	return member->data;
+	// any live instance left here is a leaked temporary. Vec2 has no copy function,
+	// so its clones and snapshot copies are byte copies only their dtor calls see
+	test_check_no_live_instances(vec2_get_type());
+#if CLASS_ENABLE_STATS
+	const ClassStats stats = class_type_get_stats(vec2_get_type());
+	TEST_CHECK(stats.ctor_calls == 3 && stats.copy_calls == 0 && stats.dtor_calls == 6);
+#endif
+	vec2_destroy_type();
 }
 
-typedef struct Class Class;
+// each instance owns a resource slot, the destructor releases it and a shallow clone would release it twice
+#define BUFFER_MAX_SLOTS 16
 
-typedef enum FunctionType {
-	FUNCTION_TYPE_CONSTRUCTOR,
-	FUNCTION_TYPE_DESTRUCTOR,
-	FUNCTION_TYPE_MEMBER_FUNCTION,
-} FunctionType;
+static int s_buffer_acquired = 0;
+static int s_buffer_releases[BUFFER_MAX_SLOTS];
+static float s_buffer_values[BUFFER_MAX_SLOTS];
 
-typedef struct Function {
-	char* name;
-	FunctionType type;
-	void (*fn) (const Class*);
-	Class* (*binary_member_fn) (const Class*, const Class*);
-} Function;
+static uint32_t buffer_acquire(void) {
+	const uint32_t slot = (uint32_t)(s_buffer_acquired++ % BUFFER_MAX_SLOTS);
+	s_buffer_releases[slot] = 0;
+	s_buffer_values[slot] = 0.0f;
+	return slot;
+}
 
-const char* function_get_name(const Function* function);
-FunctionType function_get_type(const Function* function);
-Class* function_invoke(const Function* function, const Class* klass, const Class* other);
+static void buffer_ctor(const Class* this) {
+	class_set_member_data((Class*)this, 0, (MemberData){ .u_data = buffer_acquire() });
+}
 
-const char* function_get_name(const Function* function)
-{
-	if (function == NULL) {
-		return NULL;
-	}
+static void buffer_dtor(const Class* this) {
+	s_buffer_releases[class_get_member_data(this, 0).u_data]++;
+}
 
-	return function->name;
+static void buffer_copy(Class* clone, const Class* source) {
+	const uint32_t slot = buffer_acquire();
+	s_buffer_values[slot] = s_buffer_values[class_get_member_data(source, 0).u_data];
+	class_set_member_data(clone, 0, (MemberData){ .u_data = slot });
 }
 
-FunctionType function_get_type(const Function* function)
-{
-	if (function == NULL) {
-		return FUNCTION_TYPE_MEMBER_FUNCTION;
+void test_copy_functions(void) {
+	const Function ctor = { .name = "buffer_ctor", .type = FUNCTION_TYPE_CONSTRUCTOR, .fn = buffer_ctor };
+	const Function dtor = { .name = "buffer_dtor", .type = FUNCTION_TYPE_DESTRUCTOR, .fn = buffer_dtor };
+	Member slot_member = { .name = "slot", .type = MEMBER_TYPE_U32 };
+	ClassCreateInfo createInfo = { .name = "Buffer", .ctor = &ctor, .dtor = &dtor, .copy = buffer_copy, .members = &slot_member, .num_members = 1 };
+	ClassType* type = class_type_create(&createInfo);
+	Class* klass = type != NULL ? class_create(type) : NULL;
+	TEST_CHECK(klass != NULL);
+	if (klass == NULL) {
+		class_type_destroy(type);
+		return;
 	}
+	s_buffer_values[class_get_member_data(klass, 0).u_data] = 3.0f;
 
-	return function->type;
-}
+	Class* clone = class_clone(klass);
+	const uint32_t clone_slot = class_get_member_data(clone, 0).u_data;
+	TEST_CHECK(clone_slot != class_get_member_data(klass, 0).u_data && s_buffer_values[clone_slot] == 3.0f);
 
-Class* function_invoke(const Function* function, const Class* klass, const Class* other)
-{
-	if (function == NULL || klass == NULL) {
-		DEBUG_BREAK("invalid function!");
-		return NULL;
-	}
+	// the shared copy is made with the copy function too once it is written
+	ClassCow snapshot = class_cow_create(klass);
+	ClassCow copy = class_cow_clone(snapshot);
+	s_buffer_values[class_get_member_data(class_cow_write(&copy), 0).u_data] = 5.0f;
+	TEST_CHECK(s_buffer_values[class_get_member_data(class_cow_read(snapshot), 0).u_data] == 3.0f);
+	class_cow_release(&copy);
+	class_cow_release(&snapshot);
 
-	const FunctionType type = function_get_type(function);
+	class_destroy(clone);
+	class_destroy(klass);
 
-	switch (type) {
-		case FUNCTION_TYPE_CONSTRUCTOR: function->fn(klass); return NULL;
-		case FUNCTION_TYPE_DESTRUCTOR: function->fn(klass); return NULL;
-		case FUNCTION_TYPE_MEMBER_FUNCTION: {
-			if (other == NULL) {
-				function->fn(klass);
-				return NULL;
-			} else {
-				return function->binary_member_fn(klass, other);
-			}
-		}
+	// every slot was released exactly once, the clone, the snapshot and the written copy each ran the copy function
+	TEST_CHECK(s_buffer_acquired == 4);
+	for (int i = 0; i < s_buffer_acquired; i++) {
+		TEST_CHECK(s_buffer_releases[i] == 1);
 	}
+#if CLASS_ENABLE_STATS
+	const ClassStats stats = class_type_get_stats(type);
+	TEST_CHECK(stats.ctor_calls == 1 && stats.copy_calls == 3 && stats.ctor_calls + stats.copy_calls == stats.dtor_calls);
+#endif
+	test_check_no_live_instances(type);
+	class_type_destroy(type);
+}
 
-	DEBUG_BREAK("unknown function type!");
-	return NULL;
-}
-
-typedef struct Class {
-	char* name;
-	Function* ctor;
-	Function* dtor;
-	Member* members;
-	size_t num_members;
-	Function* functions;
-	size_t num_functions;
-} Class;
-
-typedef struct ClassCreateInfo {
-	const char* name;
-	Function* ctor;
-	Function* dtor;
-	const Member* members;
-	size_t num_members;
-	const Function* functions;
-	size_t num_functions;
-} ClassCreateInfo;
-
-Class* class_create(const ClassCreateInfo* createInfo);
-void class_destroy(Class* klass);
-const char* class_get_name(const Class* klass);
-int class_has_constructor(const Class* klass);
-int class_has_destructor(const Class* klass);
-Function* class_get_constructor(const Class* klass);
-Function* class_get_destructor(const Class* klass);
-Class* class_invoke_function(const Class* klass, const Class* other, size_t index);
-void class_add_member(Class* klass, Member* member);
-void class_add_function(Class* klass, Function* function);
-Member* class_get_member(const Class* klass, size_t index);
-Function* class_get_function(const Class* klass, size_t index);
-size_t class_get_num_members(const Class* klass);
-size_t class_get_num_functions(const Class* klass);
-void class_debug_print(const Class* klass);
-
-Class* class_create(const ClassCreateInfo* createInfo)
-{
-	Class* klass = (Class*)malloc(sizeof(Class));
+void test_json_escape(void) {
+	Member member = { .name = "tab\tname", .type = MEMBER_TYPE_I32 };
+	ClassCreateInfo createInfo = { .name = "Quoted\"\n", .members = &member, .num_members = 1 };
+	ClassType* type = class_type_create(&createInfo);
+	Class* klass = type != NULL ? class_create(type) : NULL;
+	TEST_CHECK(klass != NULL);
 	if (klass == NULL) {
-		return NULL;
+		class_type_destroy(type);
+		return;
 	}
 
-	klass->name = (char*)createInfo->name;
+	// control characters come out as \u escapes, quotes and backslashes are escaped with a backslash
+	char buffer[256];
+	TestText json = { .length = 0 };
+	ClassWriter writer;
+	class_writer_init(&writer, buffer, sizeof(buffer), CLASS_FORMAT_JSON, test_text_sink, &json);
+	class_write(&writer, klass);
+	class_writer_flush(&writer);
+	TEST_CHECK(strstr(json.data, "\"Quoted\\\"\\u000a\"") != NULL);
+	TEST_CHECK(strstr(json.data, "\"tab\\u0009name\"") != NULL);
+	TEST_CHECK(strchr(json.data, '\n') == NULL || strchr(json.data, '\n') == json.data + json.length - 1);
 
-	if (createInfo->ctor != NULL) {
-		klass->ctor = (Function*)malloc(sizeof(Function));
-		if (klass->ctor == NULL) {
-			return NULL;
-		}
-		klass->ctor->fn = createInfo->ctor->fn;
-		klass->ctor->name = createInfo->ctor->name;
-	} else {
-		klass->ctor = NULL;
+	class_destroy(klass);
+	class_type_destroy(type);
+
+	// csv header fields with separators, quotes or line breaks are quoted with their quotes doubled
+	Member csv_members[] = {
+		{ .name = "a,b", .type = MEMBER_TYPE_I32 },
+		{ .name = "say \"hi\"", .type = MEMBER_TYPE_I32 },
+		{ .name = "two\nlines", .type = MEMBER_TYPE_I32 },
+		{ .name = "plain", .type = MEMBER_TYPE_I32 },
+	};
+	ClassCreateInfo csv_info = { .name = "Csv", .members = csv_members, .num_members = 4 };
+	type = class_type_create(&csv_info);
+	klass = type != NULL ? class_create(type) : NULL;
+	TEST_CHECK(klass != NULL);
+	if (klass != NULL) {
+		TestText csv = { .length = 0 };
+		class_writer_init(&writer, buffer, sizeof(buffer), CLASS_FORMAT_CSV, test_text_sink, &csv);
+		class_write_batch(&writer, (const Class* const*)&klass, 1);
+		const char* header = "\"a,b\",\"say \"\"hi\"\"\",\"two\nlines\",plain\n";
+		TEST_CHECK(strncmp(csv.data, header, strlen(header)) == 0);
 	}
+	class_destroy(klass);
+	class_type_destroy(type);
+}
 
-	if (createInfo->dtor != NULL) {
-		klass->dtor = (Function*)malloc(sizeof(Function));
-		if (klass->dtor == NULL) {
-			return NULL;
+static int registry_worker(void* arg) {
+	const ClassType* type = (const ClassType*)arg;
+	Class* objects[128];
+	for (int round = 0; round < 1000; round++) {
+		for (int i = 0; i < 128; i++) {
+			objects[i] = class_create(type);
+		}
+		for (int i = 0; i < 128; i++) {
+			class_destroy(objects[i]);
 		}
-		klass->dtor->fn = createInfo->dtor->fn;
-		klass->dtor->name = createInfo->dtor->name;
-	} else {
-		klass->dtor = NULL;
 	}
 
-	klass->members = (Member*)malloc(sizeof(Member) * createInfo->num_members);
-	if (klass->members == NULL) {
-		return NULL;
-	}
+	class_registry_flush_thread_cache();
+	return 0;
+}
 
-	klass->num_members = createInfo->num_members;
-	for (size_t i = 0; i < klass->num_members; i++) {
-		Member* member = &klass->members[i];
-		const Member* other = &createInfo->members[i];
-		member->name = other->name;
-		member->type = other->type;
-		member->data = other->data;
-	}
+void test_class_registry(void) {
+	Member count_member = { .name = "count", .type = MEMBER_TYPE_U32 };
+	ClassCreateInfo createInfo = {
+		.name = "Counter",
+		.members = &count_member,
+		.num_members = 1
+	};
+	ClassType* type = class_type_create(&createInfo);
+	TEST_CHECK(type != NULL && class_registry_register(type) == 1);
+	if (type == NULL)
+		return;
+	TEST_CHECK(class_registry_find("Counter") == type);
+	TEST_CHECK(class_registry_find("Missing") == NULL);
 
-	klass->functions = (Function*)malloc(sizeof(Function) * createInfo->num_functions);
-	if (klass->functions == NULL) {
-		return NULL;
+	thrd_t threads[4];
+	const size_t num_threads = sizeof(threads) / sizeof(threads[0]);
+	for (size_t i = 0; i < num_threads; i++) {
+		thrd_create(&threads[i], registry_worker, (void*)class_registry_find("Counter"));
 	}
-
-	klass->num_functions = createInfo->num_functions;
-	for (size_t i = 0; i < klass->num_functions; i++) {
-		Function* function = &klass->functions[i];
-		const Function* other = &createInfo->functions[i];
-		function->fn = other->fn;
-		function->binary_member_fn = other->binary_member_fn;
-		function->name = other->name;
-		function->type = other->type;
+	for (size_t i = 0; i < num_threads; i++) {
+		thrd_join(threads[i], NULL);
 	}
 
-	if (class_has_constructor(klass) == 1) {
-		klass->ctor->type = FUNCTION_TYPE_CONSTRUCTOR;
-		function_invoke(klass->ctor, klass, NULL);
-	}
+#if CLASS_ENABLE_STATS
+	const ClassStats stats = class_type_get_stats(type);
+	TEST_CHECK(stats.total_allocations == num_threads * 128 * 1000);
+#endif
+	test_check_no_live_instances(type);
 
-	return klass;
+	class_registry_shutdown();
+	class_type_destroy(type);
 }
 
-void class_destroy(Class* klass)
-{
-	if (klass == NULL) {
-		DEBUG_BREAK("invalid class!");
-		return;
+// interns enough names to grow the entry chunks and the slot table several times
+static int name_intern_worker(void* arg) {
+	char name[32];
+	for (int i = 0; i < 20000; i++) {
+		snprintf(name, sizeof(name), "intern_%d", i);
+		name_intern(name);
 	}
+	return 0;
+}
 
-	if (class_has_constructor(klass) == 1) {
-		free(klass->ctor);
-	}
+void test_name_lookup_during_growth(void) {
+	const NameAtom atom = name_intern("lookup_target");
+	thrd_t thread;
+	thrd_create(&thread, name_intern_worker, NULL);
 
-	if (class_has_destructor(klass) == 1) {
-		klass->dtor->type = FUNCTION_TYPE_DESTRUCTOR;
-		function_invoke(klass->dtor, klass, NULL);
-		free(klass->dtor);
+	// reads never lock, they have to see a consistent table while the worker grows it
+	int mismatches = 0;
+	for (int i = 0; i < 20000; i++) {
+		const char* string = name_atom_get_string(atom);
+		mismatches += name_lookup("lookup_target") != atom || string == NULL || strcmp(string, "lookup_target") != 0;
 	}
+	thrd_join(thread, NULL);
 
-	const size_t num_members = class_get_num_members(klass);
-	if (num_members > 0) {
-		Member* members = klass->members;
-		free(members);
-	}
+	TEST_CHECK(mismatches == 0);
+	TEST_CHECK(name_lookup("intern_19999") != NAME_ATOM_NONE);
+	TEST_CHECK(strcmp(name_atom_get_string(name_lookup("intern_12345")), "intern_12345") == 0);
+}
 
-	const size_t num_functions = class_get_num_functions(klass);
-	if (num_functions > 0) {
-		Function* functions = klass->functions;
-		free(functions);
-	}
+void test_vec2_archive(void) {
+	Class* vectors[] = { create_vec2(1, 2), create_vec2(3, 4), create_vec2(5, 6) };
+	const size_t num_vectors = sizeof(vectors) / sizeof(vectors[0]);
+
+	FILE* file = tmpfile();
+	if (file != NULL) {
+		class_archive_write(file, vec2_get_type(), (const Class* const*)vectors, num_vectors);
+		rewind(file);
+
+		ClassArchive* archive = class_archive_read(file, vec2_get_type());
+		TEST_CHECK(archive != NULL && class_archive_get_count(archive) == num_vectors);
+		TEST_CHECK(class_archive_is_migrated(archive) == 0);
+		for (size_t i = 0; i < class_archive_get_count(archive); i++) {
+			const Class* klass = class_archive_get_instance(archive, i);
+			TEST_CHECK(class_get_type(klass) == vec2_get_type());
+			TEST_CHECK(class_get_f32(klass, 0) == class_get_f32(vectors[i], 0) && class_get_f32(klass, 1) == class_get_f32(vectors[i], 1));
+		}
 
-	free(klass);
-}
+		class_archive_destroy(archive);
+
+		// records are stored like instances, so a mapping of the file is used in place.
+		// the file is read into memory aligned like a mapping here
+		rewind(file);
+		unsigned char* image = (unsigned char*)ALIGNED_MALLOC(4096, 64);
+		const size_t size = image != NULL ? fread(image, 1, 4096, file) : 0;
+		TEST_CHECK(size > 0);
+		if (size == 0) {
+			ALIGNED_FREE(image);
+			image = NULL;
+		}
+		ClassArchive* mapped = image != NULL ? class_archive_map(image, size, vec2_get_type()) : NULL;
+		TEST_CHECK(mapped != NULL && class_archive_is_in_place(mapped) == 1);
+		for (size_t i = 0; i < class_archive_get_count(mapped); i++) {
+			const unsigned char* klass = (const unsigned char*)class_archive_get_instance(mapped, i);
+			TEST_CHECK(klass > image && klass < image + size);
+			TEST_CHECK(class_get_type((const Class*)klass) == vec2_get_type());
+			TEST_CHECK(class_get_f32((const Class*)klass, 1) == class_get_f32(vectors[i], 1));
+		}
+		class_archive_destroy(mapped);
 
-const char* class_get_name(const Class* klass)
-{
-	if (klass == NULL) {
-		return NULL;
+		// a truncated image is rejected
+		TEST_CHECK(image == NULL || class_archive_read_memory(image, size - 1, vec2_get_type()) == NULL);
+		ALIGNED_FREE(image);
+		fclose(file);
 	}
 
-	return klass->name;
-}
-
-int class_has_constructor(const Class* klass)
-{
-	if (klass == NULL) {
-		return 0;
+	for (size_t i = 0; i < num_vectors; i++) {
+		class_destroy(vectors[i]);
 	}
 
-	return klass->ctor != NULL;
+	vec2_destroy_type();
 }
 
-int class_has_destructor(const Class* klass)
-{
-	if (klass == NULL) {
-		return 0;
-	}
+static void test_write_u32(FILE* file, uint32_t value) {
+	fwrite(&value, sizeof(value), 1, file);
+}
 
-	return klass->dtor != NULL;
+static void test_write_string(FILE* file, const char* string) {
+	test_write_u32(file, (uint32_t)strlen(string));
+	fwrite(string, 1, strlen(string), file);
 }
 
-Function* class_get_constructor(const Class* klass)
-{
-	if (klass == NULL) {
-		return NULL;
+void test_legacy_archive(void) {
+	FILE* file = tmpfile();
+	TEST_CHECK(file != NULL);
+	if (file == NULL)
+		return;
+
+	// a version 3 archive of one Vec2, the payloads are stored packed without instance headers
+	const uint64_t hash = 0, count = 1;
+	const float payload[2] = { 7, 9 };
+	test_write_u32(file, CLASS_ARCHIVE_MAGIC);
+	test_write_u32(file, 3);
+	test_write_u32(file, 1);
+	fwrite(&hash, sizeof(hash), 1, file);
+	test_write_u32(file, sizeof(payload));
+	test_write_u32(file, 2);
+	fwrite(&count, sizeof(count), 1, file);
+	test_write_string(file, "Vec2");
+	test_write_u32(file, MEMBER_TYPE_F32);
+	test_write_u32(file, 0);
+	test_write_u32(file, 0);
+	test_write_string(file, "x");
+	test_write_u32(file, MEMBER_TYPE_F32);
+	test_write_u32(file, 4);
+	test_write_u32(file, 0);
+	test_write_string(file, "y");
+	fwrite(payload, sizeof(payload), 1, file);
+	rewind(file);
+
+	ClassArchive* archive = class_archive_read(file, vec2_get_type());
+	TEST_CHECK(archive != NULL && class_archive_get_count(archive) == 1);
+	TEST_CHECK(class_archive_is_migrated(archive) == 0 && class_archive_get_schema_version(archive) == 1);
+	if (archive != NULL) {
+		const Class* klass = class_archive_get_instance(archive, 0);
+		TEST_CHECK(class_get_f32(klass, 0) == 7 && class_get_f32(klass, 1) == 9);
 	}
 
-	return klass->ctor;
+	class_archive_destroy(archive);
+	fclose(file);
+	vec2_destroy_type();
 }
 
-Function* class_get_destructor(const Class* klass)
-{
-	if (klass == NULL) {
-		return NULL;
+void test_vec2_batch(void) {
+	const ClassType* type = vec2_get_type();
+	ClassBatch* batch = class_batch_create(type, 1024);
+	if (batch == NULL)
+		return;
+
+	for (int i = 0; i < 1024; i++) {
+		const size_t row = class_batch_push(batch);
+		MemberData x = { .f_data = (float)i };
+		class_batch_row_set_member_data(class_batch_get_row(batch, row), 0, x);
 	}
 
-	return klass->dtor;
+	// a pass over one member streams through a single float array
+	const float* xs = (const float*)class_batch_get_column(batch, 0);
+	float sum = 0.0f;
+	for (size_t i = 0; i < class_batch_get_count(batch); i++) {
+		sum += xs[i];
+	}
+	TEST_CHECK(sum == 1023.0f * 1024.0f / 2.0f);
+
+	ClassBatch* doubled = class_batch_create(type, 0);
+	class_batch_invoke(class_type_get_function(type, 0), doubled, batch, batch, class_batch_get_count(batch));
+	TEST_CHECK(class_batch_get_count(doubled) == 1024);
+	TEST_CHECK(class_batch_row_get_member_data(class_batch_get_row(doubled, 1023), 0).f_data == 2046);
+	class_batch_destroy(doubled);
+
+	class_batch_destroy(batch);
+	vec2_destroy_type();
 }
 
-Class* class_invoke_function(const Class* klass, const Class* other, size_t index)
-{
-	if (klass == NULL) {
-		DEBUG_BREAK("invalid class!");
-		return NULL;
-	}
+void test_vec2_allocators(void) {
+	const ClassType* type = vec2_get_type();
+	if (type == NULL)
+		return;
 
-	const size_t num_functions = class_get_num_functions(klass);
-	if (index > num_functions - 1) {
-		DEBUG_BREAK("index out of bounds!");
-		return NULL;
+	// long lived instances come out of a pool sized for the type
+	Pool* pool = pool_create_aligned(class_type_get_instance_size(type), 64, class_type_get_instance_alignment(type));
+	Class* a = class_create_with_allocator(type, pool_get_allocator(pool));
+	Class* b = class_create_with_allocator(type, pool_get_allocator(pool));
+	TEST_CHECK(a != NULL && b != NULL && a != b);
+	TEST_CHECK((uintptr_t)a % class_type_get_instance_alignment(type) == 0);
+	class_set_f32(a, 0, 3);
+
+	// per frame temporaries are bump allocated and released together
+	Arena* arena = arena_create(class_type_get_instance_size(type) * 64);
+	for (int frame = 0; frame < 4; frame++) {
+		for (int i = 0; i < 16; i++) {
+			Class* temp = class_create_with_allocator(type, arena_get_allocator(arena));
+			TEST_CHECK(temp != NULL);
+			if (temp == NULL)
+				break;
+			class_set_member_data(temp, 0, class_get_member_data(a, 0));
+			TEST_CHECK(class_get_f32(temp, 0) == 3 && class_get_f32(temp, 1) == 0);
+		}
+		arena_reset(arena);
 	}
 
-	const Function* function = class_get_function(klass, index);
-	return function_invoke(function, klass, other);
+	class_destroy_with_allocator(a, pool_get_allocator(pool));
+	class_destroy_with_allocator(b, pool_get_allocator(pool));
+	arena_destroy(arena);
+	pool_destroy(pool);
+	vec2_destroy_type();
 }
 
-void class_add_member(Class* klass, Member* member)
-{
-	if (klass == NULL) {
-		DEBUG_BREAK("invalid class!");
+#define PARTICLE_MEMBERS(MEMBER, C) MEMBER(C, f32x4, position) MEMBER(C, f32x4, velocity) MEMBER(C, f32, mass)
+#define PARTICLE_METHODS(METHOD, C)
+
+CLASS_DEFINE(Particle, PARTICLE_MEMBERS, PARTICLE_METHODS, NULL, NULL)
+
+void test_vector_members(void) {
+	ClassType* type = class_type_create(&Particle_create_info);
+	if (type == NULL)
 		return;
-	}
 
-	if (member == NULL) {
-		DEBUG_BREAK("invalid member!");
+	// a 4x4 matrix is one f32[] member instead of sixteen scalars
+	Member transform = { .name = "transform", .type = MEMBER_TYPE_F32_ARRAY, .count = 16 };
+	TEST_CHECK(class_type_add_member(type, &transform) == 1);
+	TEST_CHECK(class_type_get_num_members(type) == 4);
+
+	Class* particle = class_create(type);
+	TEST_CHECK(particle != NULL);
+	if (particle == NULL) {
+		class_type_destroy(type);
 		return;
 	}
+	ParticleData* data = CLASS_DATA(Particle, particle);
+	for (int i = 0; i < 4; i++) {
+		data->velocity.v[i] = (float)(i + 1);
+	}
 
-	const size_t element_size = sizeof(Member);
-	const size_t num_members = class_get_num_members(klass);
-	const size_t data_size = element_size * num_members;
+	// both vectors are 16 byte aligned, the loop compiles to one aligned load per operand
+	for (int step = 0; step < 8; step++) {
+		for (int i = 0; i < 4; i++) {
+			data->position.v[i] += data->velocity.v[i] * 0.5f;
+		}
+	}
 
-	klass->members = realloc(klass->members, data_size + element_size);
-	if (klass->members == NULL) {
-		return;
+	TEST_CHECK((uintptr_t)&data->position % 16 == 0 && (uintptr_t)&data->velocity % 16 == 0);
+	for (int i = 0; i < 4; i++) {
+		TEST_CHECK(data->position.v[i] == (float)(i + 1) * 4.0f);
 	}
 
-	klass->num_members++;
+	float* matrix = (float*)class_get_member_address(particle, 3);
+	TEST_CHECK(matrix != NULL && (uintptr_t)matrix % 16 == 0);
+	for (int i = 0; i < 4; i++) {
+		matrix[i * 5] = 1.0f;
+	}
+	TEST_CHECK(matrix[0] == 1 && matrix[1] == 0 && matrix[15] == 1);
 
-	klass->members[klass->num_members - 1] = *member;
+	class_destroy(particle);
+	class_type_destroy(type);
 }
 
-void class_add_function(Class* klass, Function* function)
-{
-	if (klass == NULL) {
-		DEBUG_BREAK("invalid class!");
+void test_class_store(void) {
+	const ClassType* type = vec2_get_type();
+	ClassStore* store = class_store_create(type, 16);
+	if (store == NULL)
 		return;
-	}
 
-	if (function == NULL) {
-		DEBUG_BREAK("invalid function!");
-		return;
+	ClassHandle handles[8];
+	for (int i = 0; i < 8; i++) {
+		handles[i] = class_store_add(store);
+		class_set_member_data(class_store_get(store, handles[i]), 0, (MemberData){ .f_data = (float)i });
 	}
 
-	const size_t element_size = sizeof(Function);
-	const size_t num_functions = class_get_num_functions(klass);
-	const size_t data_size = element_size * num_functions;
+	// removing fills the hole with the last instance, the old handle stops resolving
+	class_store_remove(store, handles[2]);
+	TEST_CHECK(class_store_get(store, handles[2]) == NULL);
+	TEST_CHECK(class_get_member_data(class_store_get(store, handles[7]), 0).f_data == 7);
+	TEST_CHECK(class_store_get_count(store) == 7);
+
+	// a reused slot gets a new generation, so the stale handle still does not match it
+	const ClassHandle reused = class_store_add(store);
+	TEST_CHECK(class_store_is_valid(store, reused) == 1);
+	TEST_CHECK(class_store_is_valid(store, handles[2]) == 0);
+	TEST_CHECK(class_store_get(store, handles[2]) == NULL);
+
+	float sum = 0.0f;
+	for (size_t i = 0; i < class_store_get_count(store); i++) {
+		sum += class_get_member_data(class_store_get_instance(store, i), 0).f_data;
+	}
+	TEST_CHECK(sum == 28 - 2);
+	class_store_destroy(store);
 
-	klass->functions = realloc(klass->functions, data_size + element_size);
-	if (klass->functions == NULL) {
+	// a slot is retired once every generation has been handed out, the next add takes a fresh slot
+	store = class_store_create(type, 1);
+	if (store == NULL)
+		return;
+	const ClassHandle first = class_store_add(store);
+	class_store_remove(store, first);
+	for (uint32_t generation = 2; generation <= CLASS_HANDLE_GENERATION_MASK; generation++) {
+		class_store_remove(store, class_store_add(store));
+	}
+	const ClassHandle fresh = class_store_add(store);
+	TEST_CHECK((fresh & CLASS_HANDLE_INDEX_MASK) != (first & CLASS_HANDLE_INDEX_MASK));
+	TEST_CHECK(class_store_is_valid(store, first) == 0 && class_store_is_valid(store, fresh) == 1);
+	TEST_CHECK(class_store_is_valid(store, CLASS_HANDLE_NONE) == 0);
+	class_store_destroy(store);
+
+	// growth stops at the handle index range instead of doubling past it
+	store = class_store_create(type, 0);
+	if (store == NULL)
 		return;
+	const size_t num_instances = (1u << 19) + 1000;
+	ClassHandle last = CLASS_HANDLE_NONE;
+	for (size_t i = 0; i < num_instances; i++) {
+		last = class_store_add(store);
 	}
+	TEST_CHECK(last != CLASS_HANDLE_NONE && class_store_get_count(store) == num_instances);
+	TEST_CHECK(store->capacity == CLASS_HANDLE_INDEX_MASK);
+	class_store_destroy(store);
 
-	klass->num_functions++;
+	vec2_destroy_type();
+}
 
-	klass->functions[klass->num_functions - 1] = *function;
+static int destroy_queue_worker(void* arg) {
+	return (int)class_destroy_queue_flush((ClassDestroyQueue*)arg);
 }
 
-Member* class_get_member(const Class* klass, size_t index)
-{
-	if (klass == NULL) {
-		return NULL;
-	}
+void test_deferred_destroy(void) {
+	const ClassType* type = vec2_get_type();
+	ClassDestroyQueue* queue = class_destroy_queue_create(256);
+	if (queue == NULL)
+		return;
 
-	const size_t num_members = class_get_num_members(klass);
-	if (index < num_members) {
-		return &klass->members[index];
+	// the frame only queues its dead objects, the destructors and frees run on another thread
+	for (int i = 0; i < 256; i++) {
+		class_destroy_deferred(queue, class_create(type));
 	}
-
-	DEBUG_BREAK("index out of bounds!");
-	return NULL;
+	TEST_CHECK(class_destroy_queue_get_pending(queue) == 256);
+
+	thrd_t thread;
+	int destroyed = 0;
+	thrd_create(&thread, destroy_queue_worker, queue);
+	thrd_join(thread, &destroyed);
+	TEST_CHECK(destroyed == 256);
+	TEST_CHECK(class_destroy_queue_get_pending(queue) == 0);
+	test_check_no_live_instances(type);
+
+	class_destroy_queue_destroy(queue);
+	vec2_destroy_type();
 }
 
-Function* class_get_function(const Class* klass, size_t index)
-{
-	if (klass == NULL) {
-		return NULL;
-	}
+void test_dirty_tracking(void) {
+	const ClassType* type = vec2_get_type();
+	Class* klass = create_vec2(1, 2);
+	if (klass == NULL)
+		return;
 
-	const size_t num_functions = class_get_num_functions(klass);
-	if (index < num_functions) {
-		return &klass->functions[index];
-	}
+	// writes through the payload struct are not seen, the setters record the member they wrote
+	class_clear_dirty(klass);
+	TEST_CHECK(class_get_dirty_mask(klass) == 0);
+	class_set_member_f32(klass, 1, 5.0f);
+	TEST_CHECK(class_is_member_dirty(klass, 0) == 0 && class_is_member_dirty(klass, 1) == 1);
+
+	// the typed accessors read the field in place, the setter marks it like the checked one
+	class_set_f32(klass, 0, class_get_f32(klass, 0) + class_get_f32(klass, 1));
+	TEST_CHECK(class_get_f32(klass, 0) == 6);
+	TEST_CHECK(class_get_dirty_mask(klass) == 3);
+	class_clear_dirty(klass);
+	TEST_CHECK(class_get_dirty_mask(klass) == 0);
+	class_destroy(klass);
 
-	DEBUG_BREAK("index out of bounds!");
-	return NULL;
-}
+	ClassBatch* batch = class_batch_create(type, 1024);
+	if (batch == NULL)
+		return;
 
-size_t class_get_num_members(const Class* klass)
-{
-	if (klass == NULL) {
-		return 0;
+	for (int i = 0; i < 1024; i++) {
+		class_batch_push(batch);
 	}
 
-	return klass->num_members;
-}
-
-size_t class_get_num_functions(const Class* klass)
-{
-	if (klass == NULL) {
-		return 0;
+	// a sync pass only visits the rows that changed
+	for (int i = 0; i < 1024; i += 100) {
+		MemberData x = { .f_data = (float)i };
+		class_batch_row_set_member_data(class_batch_get_row(batch, i), 0, x);
+	}
+	class_batch_row_set_member_data(class_batch_get_row(batch, 0), 0, (MemberData){ .f_data = 1.0f });
+	TEST_CHECK(class_batch_get_num_dirty(batch) == 11);
+	for (size_t i = 0; i < class_batch_get_num_dirty(batch); i++) {
+		const size_t row = class_batch_get_dirty_row(batch, i);
+		TEST_CHECK(row % 100 == 0);
+		TEST_CHECK(class_batch_row_get_dirty_mask(class_batch_get_row(batch, row)) == 1);
 	}
+	class_batch_clear_dirty(batch);
+	TEST_CHECK(class_batch_get_num_dirty(batch) == 0);
+	TEST_CHECK(class_batch_row_get_dirty_mask(class_batch_get_row(batch, 100)) == 0);
 
-	return klass->num_functions;
+	class_batch_destroy(batch);
+	vec2_destroy_type();
 }
 
-void class_debug_print(const Class* klass)
-{
-	if (klass == NULL) {
+// unary member functions get a const instance, like the constructors they write through the payload
+static void vec2_double(const Class* this) {
+	Vec2Data* data = CLASS_DATA(Vec2, (Class*)this);
+	data->x *= 2.0f;
+	data->y *= 2.0f;
+}
+
+void test_parallel_for(void) {
+	const ClassType* type = vec2_get_type();
+	const Function vec2_double_fn = { .name = "double", .type = FUNCTION_TYPE_MEMBER_FUNCTION, .fn = vec2_double };
+	ClassBatch* batch = class_batch_create(type, 100000);
+	ClassBatch* sums = class_batch_create(type, 0);
+	if (batch == NULL || sums == NULL) {
+		class_batch_destroy(sums);
+		class_batch_destroy(batch);
 		return;
 	}
 
-	const char* class_name = class_get_name(klass);
-	const size_t num_members = class_get_num_members(klass);
-	const size_t num_functions = class_get_num_functions(klass);
-
-	printf("Class: %s\n", class_name);
-	printf("Data Members: %zu\n", num_members);
-	printf("Member Functions: %zu\n", num_functions);
-
-	printf("Ctor: ");
-	if (class_has_constructor(klass) == 1) {
-		const Function* ctor = class_get_constructor(klass);
-		const char* ctor_name = function_get_name(ctor);
-		printf("%s", ctor_name);
-	} else {
-		printf("(null)");
+	for (int i = 0; i < 100000; i++) {
+		const size_t row = class_batch_push(batch);
+		MemberData x = { .f_data = (float)i };
+		class_batch_row_set_member_data(class_batch_get_row(batch, row), 0, x);
 	}
-	putchar('\n');
-
-	printf("Dtor: ");
-	if (class_has_destructor(klass) == 1) {
-		const Function* dtor = class_get_destructor(klass);
-		const char* dtor_name = function_get_name(dtor);
-		printf("%s", dtor_name);
-	} else {
-		printf("(null)");
+	class_batch_clear_dirty(batch);
+
+	// rows are split over every core, idle workers steal from the busy ones
+	class_batch_parallel_for(batch, &vec2_double_fn, 0);
+	class_batch_parallel_invoke(class_type_get_function(type, Vec2_slot_add), sums, batch, batch, class_batch_get_count(batch), 0);
+	TEST_CHECK(class_thread_pool_get_num_workers(class_thread_pool_get_default()) >= 1);
+	TEST_CHECK(class_batch_get_count(sums) == 100000);
+	int doubled = 1;
+	for (size_t i = 0; i < 100000; i++) {
+		const float x = class_batch_row_get_member_data(class_batch_get_row(batch, i), 0).f_data;
+		const float sum = class_batch_row_get_member_data(class_batch_get_row(sums, i), 0).f_data;
+		doubled = doubled && x == (float)i * 2.0f && sum == (float)i * 4.0f;
 	}
-	putchar('\n');
-	
-	putchar('\n');
-
-	printf("Data Members: ");
-	if (num_members == 0) {
-		printf("(null)");
-	}
-	putchar('\n');
-
-	for (size_t i = 0; i < num_members; i++) {
-		const Member* member = class_get_member(klass, i);
-		const char* name = member_get_name(member);
-		const MemberType member_type = member_get_type(member);
-		const char* type = member_type_to_string(member_type);
-		const MemberData data = member_get_data(member);
-		printf("%zu.", i + 1);
-		printf("\tName: %s\n", name);
-		printf("\tType: %s\n", type);
-		printf("\tData: ");
-		switch (member_type) {
-			case MEMBER_TYPE_F32: printf("%f", data.f_data); break;
-			case MEMBER_TYPE_F64: printf("%lf", data.d_data); break;
-			case MEMBER_TYPE_I32: printf("%d", data.i_data); break;
-			case MEMBER_TYPE_U32: printf("%i", data.u_data); break;
+	TEST_CHECK(doubled == 1);
+
+	ClassStore* store = class_store_create(type, 1000);
+	if (store != NULL) {
+		for (int i = 0; i < 1000; i++) {
+			class_set_f32(class_store_get(store, class_store_add(store)), 0, (float)i);
+		}
+		class_store_parallel_for(store, &vec2_double_fn, 64);
+		for (size_t i = 0; i < 1000; i++) {
+			TEST_CHECK(class_get_f32(class_store_get_instance(store, i), 0) == (float)i * 2.0f);
 		}
-		putchar('\n');
+		class_store_destroy(store);
 	}
 
-	putchar('\n');
+	class_batch_destroy(sums);
+	class_batch_destroy(batch);
+	class_thread_pool_shutdown_default();
+	vec2_destroy_type();
+}
 
-	printf("Member Functions: ");
-	if (num_functions == 0) {
-		printf("(null)");
-	}
-	putchar('\n');
+static int s_vec2_length_evaluations = 0;
 
-	for (size_t i = 0; i < num_functions; i++) {
-		const Function* function = class_get_function(klass, i);
-		const char* name = function_get_name(function);
-		printf("%zu.", i + 1);
-		printf("\tName: %s\n", name);
-	}
+static void vec2_length(const Class* this, void* out) {
+	const Vec2Data* data = CLASS_DATA(Vec2, (Class*)this);
+	const float length = sqrtf(data->x * data->x + data->y * data->y);
+	memcpy(out, &length, sizeof(length));
+	s_vec2_length_evaluations++;
 }
 
-void test_class_test(void) {
-	ClassCreateInfo createInfo = { .name = "TestClass" };
-	Class* klass = class_create(&createInfo);
-	if (klass == NULL)
+void test_computed_members(void) {
+	ClassType* type = (ClassType*)vec2_get_type();
+	const size_t dependencies[] = { 0, 1 };
+	const size_t length_slot = class_type_add_computed_member(type, "length", MEMBER_TYPE_F32, vec2_length, dependencies, 2);
+	Class* klass = create_vec2(3, 4);
+	if (klass == NULL || length_slot == CLASS_INVALID_SLOT) {
+		vec2_destroy_type();
 		return;
-	
-	class_debug_print(klass);
-	class_destroy(klass);
-}
+	}
 
-void vec2_ctor(const Class* this) {
-	
-}
+	// repeated reads hit the cache until x or y is written through a setter
+	s_vec2_length_evaluations = 0;
+	float length = 0.0f;
+	for (int i = 0; i < 10; i++) {
+		length = class_get_computed_data(klass, length_slot).f_data;
+	}
+	TEST_CHECK(length == 5 && s_vec2_length_evaluations == 1);
+	TEST_CHECK(class_is_computed_cached(klass, length_slot) == 1);
 
-void vec2_dtor(const Class* this) {
-	
+	class_set_f32(klass, 0, 6);
+	TEST_CHECK(class_is_computed_cached(klass, length_slot) == 0);
+	class_set_f32(klass, 1, 8);
+	length = class_get_computed_data(klass, length_slot).f_data;
+	TEST_CHECK(length == 10 && s_vec2_length_evaluations == 2);
+
+	class_destroy(klass);
+	vec2_destroy_type();
 }
 
-Class* vec2_add(const Class* lhs, const Class* rhs);
+void test_operators(void) {
+	ClassType* type = (ClassType*)vec2_get_type();
+	Class* a = create_vec2(1, 2);
+	Class* b = create_vec2(3, 4);
+	Class* out = create_vec2(0, 0);
+	if (a == NULL || b == NULL || out == NULL || class_type_add_operator_functions(type) == 0) {
+		vec2_destroy_type();
+		return;
+	}
 
-Class* create_vec2(float x, float y) {
-	Function ctor;
-	ctor.fn = vec2_ctor;
-	ctor.name = STRINGIFY(vec2_ctor);
+	// every type gets element-wise operators from its layout, x and y are one run of two f32 lanes
+	const ClassOperators* operators = class_type_get_operators(type);
+	operators->sub(out, b, a);
+	TEST_CHECK(class_get_f32(out, 0) == 2 && class_get_f32(out, 1) == 2);
+	TEST_CHECK(operators->dot(a, b) == 11);
+	class_invoke_function_into(out, a, b, class_type_find_function_slot(type, "mul"));
+	TEST_CHECK(class_get_f32(out, 0) == 3 && class_get_f32(out, 1) == 8);
+
+	// a + b * 0.5 in a single pass, without a temporary for b * 0.5
+	ClassExpr expr;
+	class_expr_init(&expr);
+	class_expr_push(&expr, a);
+	class_expr_push(&expr, b);
+	class_expr_scale(&expr, 0.5);
+	class_expr_add(&expr);
+	TEST_CHECK(class_expr_eval_into(&expr, out) == 1);
+	TEST_CHECK(class_get_f32(out, 0) == 2.5f && class_get_f32(out, 1) == 4);
+
+	class_destroy(out);
+	class_destroy(b);
+	class_destroy(a);
+	vec2_destroy_type();
+
+	// integer lanes wrap on mul and saturate on scale, the fused expression gives the same bits
+	Member integer_members[] = {
+		{ .name = "count", .type = MEMBER_TYPE_U32, .data.u_data = 70000 },
+		{ .name = "offset", .type = MEMBER_TYPE_I32, .data.i_data = 80000 },
+	};
+	ClassCreateInfo integer_info = { .name = "Counts", .members = integer_members, .num_members = 2 };
+	ClassType* integer_type = class_type_create(&integer_info);
+	Class* counts = integer_type != NULL ? class_create(integer_type) : NULL;
+	Class* product = integer_type != NULL ? class_create(integer_type) : NULL;
+	if (counts == NULL || product == NULL) {
+		class_destroy(product);
+		class_destroy(counts);
+		class_type_destroy(integer_type);
+		return;
+	}
 
-	Function dtor;
-	dtor.fn = vec2_dtor;
-	dtor.name = STRINGIFY(vec2_dtor);
+	class_mul_into(product, counts, counts);
+	TEST_CHECK(class_get_u32(product, 0) == (uint32_t)(70000u * 70000u));
+	class_expr_init(&expr);
+	class_expr_push(&expr, counts);
+	class_expr_push(&expr, counts);
+	class_expr_mul(&expr);
+	Class* fused = class_clone(product);
+	TEST_CHECK(fused != NULL && class_expr_eval_into(&expr, fused) == 1);
+	TEST_CHECK(fused != NULL && memcmp(class_get_payload(fused), class_get_payload(product), class_type_get_payload_size(integer_type)) == 0);
+
+	class_scale_into(product, counts, 1e5);
+	TEST_CHECK(class_get_u32(product, 0) == UINT32_MAX && class_get_i32(product, 1) == INT32_MAX);
+	class_scale_into(product, counts, -5.0);
+	TEST_CHECK(class_get_u32(product, 0) == 0 && class_get_i32(product, 1) == -400000);
+	class_scale_into(product, counts, NAN);
+	TEST_CHECK(class_get_u32(product, 0) == 0 && class_get_i32(product, 1) == 0);
+
+	class_destroy(fused);
+	class_destroy(product);
+	class_destroy(counts);
+	class_type_destroy(integer_type);
+}
 
-	Member x_member, y_member;
-	x_member.name = "x";
-	x_member.data.f_data = x;
-	y_member.name = "y";
-	y_member.data.f_data = y;
-	Member members[] = { x_member, y_member };
+void test_archive_migration(void) {
+	Class* vectors[] = { create_vec2(1, 2), create_vec2(3, 4) };
+	const size_t num_vectors = sizeof(vectors) / sizeof(vectors[0]);
+
+	unsigned char image[512];
+	size_t size = 0;
+	FILE* file = tmpfile();
+	TEST_CHECK(file != NULL);
+	if (file != NULL) {
+		TEST_CHECK(class_archive_write(file, vec2_get_type(), (const Class* const*)vectors, num_vectors) == 1);
+		rewind(file);
+		size = fread(image, 1, sizeof(image), file);
+		fclose(file);
+	}
 
-	const size_t num_members = sizeof(members) / sizeof(members[0]);
-	for (size_t i = 0; i < num_members; i++) {
-		Member* member = &members[i];
-		member->type = MEMBER_TYPE_F32;
+	// values that do not fit the integer members the next reader converts them to
+	Class* extremes[] = { create_vec2(-5.0f, 1e10f), create_vec2(NAN, -1e10f) };
+	unsigned char extremes_image[512];
+	size_t extremes_size = 0;
+	file = tmpfile();
+	TEST_CHECK(file != NULL);
+	if (file != NULL) {
+		TEST_CHECK(class_archive_write(file, vec2_get_type(), (const Class* const*)extremes, 2) == 1);
+		rewind(file);
+		extremes_size = fread(extremes_image, 1, sizeof(extremes_image), file);
+		fclose(file);
 	}
 
-	Function add_fn;
-	add_fn.type = FUNCTION_TYPE_MEMBER_FUNCTION;
-	add_fn.binary_member_fn = vec2_add;
-	add_fn.name = STRINGIFY(vec2_add);
+	for (size_t i = 0; i < num_vectors; i++) {
+		class_destroy(vectors[i]);
+		class_destroy(extremes[i]);
+	}
+	vec2_destroy_type();
+
+	// a computed member grows the payload but not the stored layout, the archive still matches
+	ClassType* computed_type = (ClassType*)vec2_get_type();
+	const size_t dependencies[] = { 0, 1 };
+	const uint64_t stored_hash = class_type_get_schema_hash(computed_type);
+	const size_t length_slot = class_type_add_computed_member(computed_type, "length", MEMBER_TYPE_F32, vec2_length, dependencies, 2);
+	TEST_CHECK(class_type_get_schema_hash(computed_type) == stored_hash);
+	ClassArchive* archive = class_archive_read_memory(image, size, computed_type);
+	TEST_CHECK(archive != NULL && class_archive_is_migrated(archive) == 0);
+	if (archive != NULL && length_slot != CLASS_INVALID_SLOT) {
+		const Class* klass = class_archive_get_instance(archive, 1);
+		TEST_CHECK(class_get_f32(klass, 0) == 3 && class_get_f32(klass, 1) == 4);
+		TEST_CHECK(class_get_computed_data(klass, length_slot).f_data == 5);
+	}
+	class_archive_destroy(archive);
+	vec2_destroy_type();
 
-	ClassCreateInfo createInfo = {
-		.name = "Vec2",
-		.ctor = &ctor,
-		.dtor = &dtor,
-		.members = members,
-		.num_members = num_members,
-		.functions = &add_fn,
-		.num_functions = 1
+	// conversions to integer members saturate and NaN becomes 0
+	Member integer_members[] = {
+		{ .name = "x", .type = MEMBER_TYPE_U32 },
+		{ .name = "y", .type = MEMBER_TYPE_I32 },
 	};
+	ClassCreateInfo integer_info = { .name = "Vec2", .members = integer_members, .num_members = 2 };
+	ClassType* integer_type = class_type_create(&integer_info);
+	archive = integer_type != NULL ? class_archive_read_memory(extremes_image, extremes_size, integer_type) : NULL;
+	TEST_CHECK(archive != NULL && class_archive_get_count(archive) == 2);
+	if (archive != NULL) {
+		const Class* first = class_archive_get_instance(archive, 0);
+		const Class* second = class_archive_get_instance(archive, 1);
+		TEST_CHECK(class_get_u32(first, 0) == 0 && class_get_i32(first, 1) == INT32_MAX);
+		TEST_CHECK(class_get_u32(second, 0) == 0 && class_get_i32(second, 1) == INT32_MIN);
+	}
+	class_archive_destroy(archive);
+	class_type_destroy(integer_type);
+
+	// the next version of Vec2 stores x as f64 and gains a z that old archives do not have
+	Member members[] = {
+		{ .name = "z", .type = MEMBER_TYPE_F32, .data.f_data = 1.0f },
+		{ .name = "x", .type = MEMBER_TYPE_F64 },
+		{ .name = "y", .type = MEMBER_TYPE_F32 },
+	};
+	ClassCreateInfo createInfo = { .name = "Vec2", .members = members, .num_members = sizeof(members) / sizeof(members[0]) };
+	ClassType* type = class_type_create(&createInfo);
+	if (type == NULL)
+		return;
+	class_type_set_schema_version(type, 2);
+
+	// the image could just as well be a mapped file
+	archive = class_archive_read_memory(image, size, type);
+	TEST_CHECK(archive != NULL && class_archive_get_count(archive) == 2);
+	TEST_CHECK(class_archive_is_migrated(archive) == 1);
+	TEST_CHECK(class_archive_get_schema_hash(archive) != class_type_get_schema_hash(type));
+	for (size_t i = 0; i < class_archive_get_count(archive); i++) {
+		const Class* klass = class_archive_get_instance(archive, i);
+		TEST_CHECK(class_get_f64(klass, 1) == (double)(i * 2 + 1));
+		TEST_CHECK(class_get_f32(klass, 2) == (float)(i * 2 + 2));
+		TEST_CHECK(class_get_f32(klass, 0) == 1);
+	}
 
-	Class* klass = class_create(&createInfo);
-	if (klass == NULL)
-		return NULL;
-
-	return klass;
-}
-
-Class* vec2_add(const Class* lhs, const Class* rhs) {
-	Class* result = create_vec2(0, 0);
-	result->members[0].data.f_data = lhs->members[0].data.f_data + rhs->members[0].data.f_data;
-	result->members[1].data.f_data = lhs->members[1].data.f_data + rhs->members[1].data.f_data;
-	return result;
+	class_archive_destroy(archive);
+	class_type_destroy(type);
+
+	// unnamed members hash and store as empty names
+	Member unnamed_members[] = { { .type = MEMBER_TYPE_U32, .data.u_data = 7 } };
+	ClassCreateInfo unnamed_info = { .name = "Unnamed", .members = unnamed_members, .num_members = 1 };
+	ClassType* unnamed_type = class_type_create(&unnamed_info);
+	TEST_CHECK(unnamed_type != NULL);
+	Class* unnamed = unnamed_type != NULL ? class_create(unnamed_type) : NULL;
+	file = unnamed != NULL ? tmpfile() : NULL;
+	if (file != NULL) {
+		TEST_CHECK(class_archive_write(file, unnamed_type, (const Class* const*)&unnamed, 1) == 1);
+		rewind(file);
+		archive = class_archive_read(file, unnamed_type);
+		TEST_CHECK(archive != NULL && class_archive_is_migrated(archive) == 0);
+		TEST_CHECK(archive != NULL && class_get_u32(class_archive_get_instance(archive, 0), 0) == 7);
+		class_archive_destroy(archive);
+		fclose(file);
+	}
+	class_destroy(unnamed);
+	class_type_destroy(unnamed_type);
 }
 
-void test_vec2_class(void) {
-	Class* a = create_vec2(1, 3);
-	Class* b = create_vec2(2, 4);
-	Class* c = class_invoke_function(a, b, 0);
-	class_debug_print(c);
-	Class* classes[] = { a, b, c };
-	const size_t num_classes = sizeof(classes) / sizeof(classes[0]);
-	for (size_t i = 0; i < num_classes; i++) {
-		Class* klass = classes[i];
-		class_destroy(klass);
+void test_call_tracing(void) {
+	class_trace_set_enabled(1);
+	Class* a = create_vec2(1, 2);
+	Class* b = create_vec2(3, 4);
+	if (a != NULL && b != NULL) {
+		class_invoke_function_into(b, a, b, Vec2_slot_add);
 	}
+	class_destroy(b);
+	class_destroy(a);
+	class_trace_set_enabled(0);
+
+	// two ctors, the add and two dtors
+	TEST_CHECK(class_trace_get_num_events() == 5);
+
+	// the file loads in perfetto or chrome://tracing
+	FILE* file = tmpfile();
+	TEST_CHECK(file != NULL);
+	if (file != NULL) {
+		TestText trace = { .length = 0 };
+		TEST_CHECK(class_trace_export_chrome(file) == 1);
+		test_text_read_file(&trace, file);
+		TEST_CHECK(strstr(trace.data, "\"name\":\"Vec2::add\",\"cat\":\"function\",\"ph\":\"X\"") != NULL);
+		TEST_CHECK(strstr(trace.data, "\"cat\":\"ctor\"") != NULL && strstr(trace.data, "\"cat\":\"dtor\"") != NULL);
+		fclose(file);
+	}
+
+	// calls made while tracing is off are not recorded
+	Class* untraced = create_vec2(0, 0);
+	class_destroy(untraced);
+	TEST_CHECK(class_trace_get_num_events() == 5);
+	class_trace_clear();
+	TEST_CHECK(class_trace_get_num_events() == 0);
+
+	class_trace_shutdown();
+	vec2_destroy_type();
 }
 
 int main(int argc, char** argv) {
 	test_class_test();
+	test_vec3_inheritance();
+	test_vec2_class();
+	test_copy_functions();
+	test_json_escape();
+	test_class_registry();
+	test_name_lookup_during_growth();
+	test_vec2_archive();
+	test_legacy_archive();
+	test_vec2_batch();
+	test_vec2_allocators();
+	test_vector_members();
+	test_class_store();
+	test_deferred_destroy();
+	test_dirty_tracking();
+	test_parallel_for();
+	test_computed_members();
+	test_operators();
+	test_archive_migration();
+	test_call_tracing();
+
+	if (s_failed_checks > 0) {
+		printf("%d checks failed\n", s_failed_checks);
+		return 1;
+	}
 
-	return getchar();
-}
\ No newline at end of file
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include "vec2.h"
+
+void vec2_ctor(const Class* this) {
+	
+}
+
+void vec2_dtor(const Class* this) {
+	
+}
+
+CLASS_DEFINE_INFO(Vec2, VEC2_MEMBERS, VEC2_METHODS, vec2_ctor, vec2_dtor)
+
+static ClassType* s_vec2_type = NULL;
+
+// the Vec2 type is registered once from its static descriptor and shared by every instance
+const ClassType* vec2_get_type(void) {
+	if (s_vec2_type != NULL)
+		return s_vec2_type;
+
+	s_vec2_type = class_type_create(&Vec2_create_info);
+	return s_vec2_type;
+}
+
+void vec2_destroy_type(void) {
+	if (s_vec2_type == NULL)
+		return;
+
+	class_type_destroy(s_vec2_type);
+	s_vec2_type = NULL;
+}
+
+Class* create_vec2(float x, float y) {
+	const ClassType* type = vec2_get_type();
+	if (type == NULL)
+		return NULL;
+
+	Class* klass = class_create(type);
+	if (klass == NULL)
+		return NULL;
+
+	Vec2Data* data = CLASS_DATA(Vec2, klass);
+	data->x = x;
+	data->y = y;
+	return klass;
+}
+
+Class* vec2_add(const Class* lhs, const Class* rhs) {
+	Class* result = create_vec2(0, 0);
+	if (result == NULL)
+		return NULL;
+
+	vec2_add_into(result, lhs, rhs);
+	return result;
+}
+
+void vec2_add_into(Class* out, const Class* lhs, const Class* rhs) {
+	Vec2Data* result = CLASS_DATA(Vec2, out);
+	const Vec2Data* a = CLASS_DATA(Vec2, lhs);
+	const Vec2Data* b = CLASS_DATA(Vec2, rhs);
+	result->x = a->x + b->x;
+	result->y = a->y + b->y;
+}
+
+static void f32_column_add(float* out, const float* lhs, const float* rhs, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = lhs[i] + rhs[i];
+	}
+}
+
+// one flat loop per column, the compiler vectorizes these for the target's SIMD width.
+// out may be the same batch as lhs or rhs, element i only depends on element i
+void vec2_add_batch(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count) {
+	for (size_t i = 0; i < 2; i++) {
+		float* out_column = (float*)class_batch_get_column(out, i);
+		const float* lhs_column = (const float*)class_batch_get_column(lhs, i);
+		const float* rhs_column = (const float*)class_batch_get_column(rhs, i);
+		f32_column_add(out_column, lhs_column, rhs_column, count);
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef VEC2_H
+#define VEC2_H
+
+#include "c_class.h"
+
+// the Vec2 demo type, shared by the demo and the benchmark
+Class* vec2_add(const Class* lhs, const Class* rhs);
+void vec2_add_into(Class* out, const Class* lhs, const Class* rhs);
+void vec2_add_batch(ClassBatch* out, const ClassBatch* lhs, const ClassBatch* rhs, size_t count);
+
+#define VEC2_MEMBERS(MEMBER, C) \
+	MEMBER(C, f32, x) \
+	MEMBER(C, f32, y)
+
+#define VEC2_METHODS(METHOD, C) \
+	METHOD(C, add, vec2_add, vec2_add_into, vec2_add_batch)
+
+CLASS_DECLARE(Vec2, VEC2_MEMBERS, VEC2_METHODS)
+
+void vec2_ctor(const Class* this);
+void vec2_dtor(const Class* this);
+const ClassType* vec2_get_type(void);
+void vec2_destroy_type(void);
+Class* create_vec2(float x, float y);
+
+#endif
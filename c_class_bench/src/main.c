@@ -0,0 +1,271 @@
+// links against the library and the Vec2 demo type, configure with C_CLASS_LTO=ON so calls into the library can be inlined
+#include "c_class.h"
+#include "vec2.h"
+
+#define BENCH_TARGET_OPS 4000000
+
+typedef struct BenchCounters {
+	size_t allocations;
+	size_t frees;
+} BenchCounters;
+
+static BenchCounters s_counters = { 0 };
+static volatile float s_sink = 0.0f;
+
+static void* bench_alloc(void* user_data, size_t size, size_t alignment)
+{
+	BenchCounters* counters = (BenchCounters*)user_data;
+	counters->allocations++;
+	return ALIGNED_MALLOC(size, alignment);
+}
+
+static void bench_free(void* user_data, void* memory)
+{
+	BenchCounters* counters = (BenchCounters*)user_data;
+	counters->frees++;
+	ALIGNED_FREE(memory);
+}
+
+static const Allocator s_counting_allocator = { bench_alloc, bench_free, &s_counters };
+
+// same monotonic clock as the call tracing, wall clock time can jump while a pass runs
+static double bench_now_ns(void)
+{
+	return (double)class_trace_now();
+}
+
+// repeats the measured pass until roughly BENCH_TARGET_OPS operations ran so tiny sizes are still measurable
+static size_t bench_iterations(size_t count)
+{
+	const size_t iterations = BENCH_TARGET_OPS / count;
+	return iterations > 0 ? iterations : 1;
+}
+
+static void bench_report(const char* name, size_t count, double elapsed_ns, size_t ops)
+{
+	const double ns_per_op = elapsed_ns / (double)ops;
+	const double allocs_per_op = (double)s_counters.allocations / (double)ops;
+	printf("%-28s %8zu objects %10.2f ns/op %8.2f allocs/op\n", name, count, ns_per_op, allocs_per_op);
+}
+
+static void bench_reset_counters(void)
+{
+	s_counters.allocations = 0;
+	s_counters.frees = 0;
+}
+
+static Class** bench_create_vec2s(size_t count)
+{
+	Class** objects = (Class**)malloc(sizeof(Class*) * count);
+	if (objects == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		objects[i] = create_vec2((float)i, (float)(count - i));
+	}
+
+	return objects;
+}
+
+static void bench_destroy_vec2s(Class** objects, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		class_destroy(objects[i]);
+	}
+
+	free(objects);
+}
+
+static void bench_create_destroy(size_t count)
+{
+	const ClassType* type = vec2_get_type();
+	Class** objects = (Class**)malloc(sizeof(Class*) * count);
+	if (objects == NULL) {
+		return;
+	}
+
+	const size_t iterations = bench_iterations(count);
+	bench_reset_counters();
+	const double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			objects[i] = class_create(type);
+		}
+		for (size_t i = 0; i < count; i++) {
+			class_destroy(objects[i]);
+		}
+	}
+	const double elapsed = bench_now_ns() - start;
+
+	bench_report("class_create+class_destroy", count, elapsed, iterations * count);
+	free(objects);
+}
+
+static void bench_member_access(size_t count)
+{
+	Class** objects = bench_create_vec2s(count);
+	if (objects == NULL) {
+		return;
+	}
+
+	const size_t iterations = bench_iterations(count);
+	float sum = 0.0f;
+	bench_reset_counters();
+	const double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			sum += class_get_member_data(objects[i], 1).f_data;
+		}
+	}
+	const double elapsed = bench_now_ns() - start;
+	s_sink = sum;
+
+	bench_report("class_get_member_data", count, elapsed, iterations * count);
+	bench_destroy_vec2s(objects, count);
+}
+
+static void bench_typed_member_access(size_t count)
+{
+	Class** objects = bench_create_vec2s(count);
+	if (objects == NULL) {
+		return;
+	}
+
+	const size_t iterations = bench_iterations(count);
+	float sum = 0.0f;
+	bench_reset_counters();
+	const double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			sum += class_get_f32(objects[i], 1);
+		}
+	}
+	const double elapsed = bench_now_ns() - start;
+	s_sink = sum;
+
+	bench_report("class_get_f32", count, elapsed, iterations * count);
+	bench_destroy_vec2s(objects, count);
+}
+
+static void bench_invoke_into(size_t count)
+{
+	Class** objects = bench_create_vec2s(count);
+	Class* out = create_vec2(0.0f, 0.0f);
+	if (objects == NULL || out == NULL) {
+		return;
+	}
+
+	const size_t iterations = bench_iterations(count);
+	bench_reset_counters();
+	double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			class_invoke_function_into(out, objects[i], out, 0);
+		}
+	}
+	double elapsed = bench_now_ns() - start;
+	bench_report("class_invoke_function_into", count, elapsed, iterations * count);
+
+	// the same calls with tracing on, each one lands in the thread's ring buffer
+	class_trace_set_enabled(1);
+	bench_reset_counters();
+	start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			class_invoke_function_into(out, objects[i], out, 0);
+		}
+	}
+	elapsed = bench_now_ns() - start;
+	class_trace_set_enabled(0);
+	class_trace_clear();
+	bench_report("invoke_function_into traced", count, elapsed, iterations * count);
+
+	bench_reset_counters();
+	start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			CLASS_CALL_INTO(out, objects[i], out, 0);
+		}
+	}
+	elapsed = bench_now_ns() - start;
+	bench_report("CLASS_CALL_INTO", count, elapsed, iterations * count);
+
+	s_sink = class_get_member_data(out, 0).f_data;
+	class_destroy(out);
+	bench_destroy_vec2s(objects, count);
+}
+
+static void bench_vec2_add(size_t count)
+{
+	Class** objects = bench_create_vec2s(count);
+	if (objects == NULL) {
+		return;
+	}
+
+	const size_t iterations = bench_iterations(count);
+	bench_reset_counters();
+	const double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			Class* result = class_invoke_function(objects[i], objects[count - i - 1], 0);
+			class_destroy(result);
+		}
+	}
+	const double elapsed = bench_now_ns() - start;
+
+	bench_report("vec2_add (allocating)", count, elapsed, iterations * count);
+	bench_destroy_vec2s(objects, count);
+}
+
+static void bench_vec2_add_batch(size_t count)
+{
+	const ClassType* type = vec2_get_type();
+	ClassBatch* lhs = class_batch_create(type, count);
+	ClassBatch* out = class_batch_create(type, count);
+	if (lhs == NULL || out == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		class_batch_push(lhs);
+	}
+
+	const Function* add_fn = class_type_get_function(type, 0);
+	const size_t iterations = bench_iterations(count);
+	bench_reset_counters();
+	const double start = bench_now_ns();
+	for (size_t it = 0; it < iterations; it++) {
+		class_batch_invoke(add_fn, out, lhs, lhs, count);
+	}
+	const double elapsed = bench_now_ns() - start;
+
+	bench_report("class_batch_invoke", count, elapsed, iterations * count);
+	class_batch_destroy(lhs);
+	class_batch_destroy(out);
+}
+
+int main(int argc, char** argv) {
+	const ClassType* type = vec2_get_type();
+	if (type == NULL)
+		return 1;
+
+	// route every instance allocation through the counting allocator
+	class_type_set_allocator((ClassType*)type, &s_counting_allocator);
+
+	const size_t sizes[] = { 1, 1000, 1000000 };
+	const size_t num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+	for (size_t i = 0; i < num_sizes; i++) {
+		const size_t count = sizes[i];
+		bench_create_destroy(count);
+		bench_member_access(count);
+		bench_typed_member_access(count);
+		bench_invoke_into(count);
+		bench_vec2_add(count);
+		bench_vec2_add_batch(count);
+		putchar('\n');
+	}
+
+	vec2_destroy_type();
+	return 0;
+}